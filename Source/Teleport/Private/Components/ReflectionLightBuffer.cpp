@@ -0,0 +1,134 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "Components/ReflectionLightBuffer.h"
+#include "Renderer/Private/ScenePrivate.h"
+#include "SceneManagement.h"
+#include "Containers/DynamicRHIResourceArray.h"
+#include "Engine/World.h"
+#include "RenderingThread.h"
+
+TMap<const FScene*, FReflectionLightBuffer> FReflectionLightBuffer::SceneBuffers;
+
+// A scene that no capture has asked for in this many frames has probably been destroyed.
+static constexpr uint32 StaleSceneFrames = 600;
+
+static FDelegateHandle WorldCleanupHandle;
+
+void FReflectionLightBuffer::Startup()
+{
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	{
+		// The scene is only used as a key, so it doesn't matter if it's gone by the time this runs.
+		const FScene* Scene = World && World->Scene ? World->Scene->GetRenderScene() : nullptr;
+		if (!Scene)
+		{
+			return;
+		}
+		ENQUEUE_RENDER_COMMAND(TeleportReleaseSceneReflectionLights)(
+			[Scene](FRHICommandListImmediate& RHICmdList)
+			{
+				SceneBuffers.Remove(Scene);
+			});
+	});
+}
+
+void FReflectionLightBuffer::Shutdown()
+{
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	WorldCleanupHandle.Reset();
+	ENQUEUE_RENDER_COMMAND(TeleportReleaseReflectionLights)(
+		[](FRHICommandListImmediate& RHICmdList)
+		{
+			SceneBuffers.Empty();
+		});
+	// The buffers must be released while the RHI is still there, not when the map is destroyed.
+	FlushRenderingCommands();
+}
+
+const FReflectionLightBuffer& FReflectionLightBuffer::Get(FScene* Scene)
+{
+	check(IsInRenderingThread());
+	const uint32 Frame = GFrameNumberRenderThread;
+	for (auto It = SceneBuffers.CreateIterator(); It; ++It)
+	{
+		if (It.Key() != Scene && Frame - It.Value().UpdatedFrame > StaleSceneFrames)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	FReflectionLightBuffer& LightBuffer = SceneBuffers.FindOrAdd(Scene);
+	if (!LightBuffer.bUpdated || LightBuffer.UpdatedFrame != Frame)
+	{
+		LightBuffer.Update(Scene);
+		LightBuffer.UpdatedFrame = Frame;
+		LightBuffer.bUpdated = true;
+	}
+	return LightBuffer;
+}
+
+void FReflectionLightBuffer::Update(FScene* Scene)
+{
+	TResourceArray<FShaderLight> ShaderLights;
+	for (auto& LightInfo : Scene->Lights)
+	{
+		if (!LightInfo.LightSceneInfo->bVisible)
+		{
+			continue;
+		}
+		ELightType Type;
+		switch (LightInfo.LightType)
+		{
+		case LightType_Directional:
+			Type = ELightType::Directional;
+			break;
+		case LightType_Point:
+			Type = ELightType::Point;
+			break;
+		case LightType_Spot:
+			Type = ELightType::Spot;
+			break;
+		default:
+			continue;
+		}
+		const FLightSceneProxy* Proxy = LightInfo.LightSceneInfo->Proxy;
+		FLightRenderParameters LightParameters;
+		Proxy->GetLightShaderParameters(LightParameters);
+
+		FShaderLight ShaderLight;
+		// The color includes the intensity. Divide by max intensity of 20
+		ShaderLight.Color = LightInfo.Color * 0.05f;
+		ShaderLight.Direction = FVector3f(Proxy->GetDirection());
+		ShaderLight.Type = Type;
+		ShaderLight.PositionMetres = Type == ELightType::Directional ? FVector3f::ZeroVector : FVector3f(LightParameters.WorldPosition * 0.01);
+		ShaderLight.InvRadiusMetres = Type == ELightType::Directional ? 0.0f : LightParameters.InvRadius * 100.0f;
+		ShaderLight.SpotAngles = Type == ELightType::Spot ? LightParameters.SpotAngles : FVector2f::ZeroVector;
+		ShaderLight.Pad = FVector2f::ZeroVector;
+		ShaderLights.Add(ShaderLight);
+	}
+
+	// Every member is set, so the lights can be compared as memory.
+	const uint32 NewHash = FCrc::MemCrc32(ShaderLights.GetData(), ShaderLights.Num() * sizeof(FShaderLight));
+	if (NewHash == Hash && (uint32)ShaderLights.Num() == NumLights)
+	{
+		return;
+	}
+	Hash = NewHash;
+	NumLights = ShaderLights.Num();
+	Version++;
+	if (!NumLights)
+	{
+		SRV.SafeRelease();
+		Buffer.SafeRelease();
+		return;
+	}
+	// The lights rarely change, so a new buffer is made rather than writing one the GPU may still be reading.
+	FRHIResourceCreateInfo CreateInfo(TEXT("TeleportReflectionLights"));
+	CreateInfo.ResourceArray = &ShaderLights;
+	Buffer = RHICreateStructuredBuffer(
+		sizeof(FShaderLight),
+		NumLights * sizeof(FShaderLight),
+		BUF_ShaderResource | BUF_Static,
+		CreateInfo
+	);
+	SRV = RHICreateShaderResourceView(Buffer);
+}
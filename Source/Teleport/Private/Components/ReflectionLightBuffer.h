@@ -0,0 +1,73 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+class FScene;
+
+/*! The directional, point and spot lights of a scene, in a structured buffer for the reflection lighting shader.
+
+	One buffer is shared by every reflection capture in the scene. The lights are gathered at most once per frame,
+	and the buffer is only recreated when a light is added, removed or changed. A scene's buffer is released when its
+	world is cleaned up, and all of them when the module shuts down.
+	Render thread only, apart from Startup and Shutdown.
+*/
+class FReflectionLightBuffer
+{
+public:
+	enum class ELightType : uint32
+	{
+		Directional,
+		Point,
+		Spot
+	};
+	//! Matches the Light struct in UpdateReflections.usf.
+	struct FShaderLight
+	{
+		FLinearColor Color;
+		//! The direction the light shines in.
+		FVector3f Direction;
+		ELightType Type;
+		FVector3f PositionMetres;
+		float InvRadiusMetres;
+		//! The cosine of the outer cone angle, and one over the range of cosines from there to the inner cone.
+		FVector2f SpotAngles;
+		FVector2f Pad;
+	};
+	static_assert(sizeof(FShaderLight) == 64, "FShaderLight must match the shader's layout.");
+
+	//! The scene's lights, up to date for this frame.
+	static const FReflectionLightBuffer& Get(FScene* Scene);
+	//! Game thread: call from the module's startup and shutdown.
+	static void Startup();
+	static void Shutdown();
+
+	FRHIShaderResourceView* GetSRV() const
+	{
+		return SRV;
+	}
+	uint32 GetNumLights() const
+	{
+		return NumLights;
+	}
+	//! Changes whenever the lights do.
+	uint32 GetVersion() const
+	{
+		return Version;
+	}
+
+private:
+	void Update(FScene* Scene);
+
+	FBufferRHIRef Buffer;
+	FShaderResourceViewRHIRef SRV;
+	uint32 NumLights = 0;
+	uint32 Hash = 0;
+	uint32 Version = 0;
+	uint32 UpdatedFrame = 0;
+	bool bUpdated = false;
+
+	static TMap<const FScene*, FReflectionLightBuffer> SceneBuffers;
+};
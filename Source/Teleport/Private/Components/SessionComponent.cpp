@@ -3,7 +3,6 @@
 
 #include "Components/SessionComponent.h"
 
-#include "Engine/Classes/Components/SphereComponent.h"
 #include "Engine/Classes/Components/MeshComponent.h"
 #include "GeometrySource.h"
 #include "Windows/AllowWindowsPlatformAtomics.h"
@@ -21,6 +20,7 @@
 #include "Components/TeleportClientComponent.h"
 #include "TeleportModule.h"
 #include "TeleportMonitor.h"
+#include "GeometryStreamingQueue.h"
 #define TELEPORT_EXPORT_SERVER_DLL 1
 //#include "TeleportServer/Export.h"
 
@@ -170,15 +170,12 @@ void UTeleportSessionComponent::TickComponent(float DeltaTime, ELevelTick TickTy
 	//if (!clientData->clientMessaging->isInitialised() || !ClientActor.IsValid())
 	//	return;
 	
-	if(!DetectionSphereInner.IsValid())
+	if(IsStreaming)
 	{
-		AddDetectionSpheres();
+		StreamNearbyNodes();
+		StreamQueuedNodes(DeltaTime);
 	}
 
-	DetectionSphereInner->SetSphereRadius(Monitor->DetectionSphereRadius);
-	DetectionSphereOuter->SetSphereRadius(Monitor->DetectionSphereRadius + Monitor->DetectionSphereBufferDistance);
-	
-
 	if(BandwidthStatID.IsValidStat())
 	{
 		Bandwidth *= 0.9f;
@@ -243,8 +240,14 @@ void UTeleportSessionComponent::StartSession(avs::uid clientID)
 	if (ClientActor.IsValid())
 	{
 		TeleportClientComponent=ClientActor->FindComponentByClass<UTeleportClientComponent>();
-		// Attach detection spheres to player pawn, but only if we're actually streaming geometry.
-		AddDetectionSpheres();
+		// Fill the list of streamed actors, so a reconnecting client will not have to download geometry it already has.
+		NearbyRoots.Empty();
+		bNearbyQueried = false;
+		if(!StreamingQueue)
+		{
+			StreamingQueue = MakeUnique<FGeometryStreamingQueue>();
+		}
+		StreamingQueue->Reset();
 		StreamNearbyNodes();
 	} 
 	
@@ -339,19 +342,90 @@ void UTeleportSessionComponent::ProcessInputEvents( uint16_t numBinaryEvents, ui
 
 void UTeleportSessionComponent::StreamNearbyNodes()
 {
-	if (teleport::server::GetServerSettings().enableGeometryStreaming)
+	if (!teleport::server::GetServerSettings().enableGeometryStreaming || !ClientActor.IsValid() || !Monitor || !StreamingQueue)
 	{
-		// Fill the list of streamed actors, so a reconnecting client will not have to download geometry it already has.
-		TSet<AActor *> actorsOverlappingOnStart;
-		DetectionSphereInner->GetOverlappingActors(actorsOverlappingOnStart);
-		for (AActor *a : actorsOverlappingOnStart)
+		return;
+	}
+	const FStreamableSpatialIndex &Index = Monitor->StreamableIndex;
+	const FVector Location = ClientActor->GetActorLocation();
+	const float InnerRadius = float(Monitor->DetectionSphereRadius);
+	const float OuterRadius = InnerRadius + float(Monitor->DetectionSphereBufferDistance);
+	// Within a fraction of the buffer distance, nothing can have crossed the outer radius, and little the inner.
+	const float RequeryDistance = FMath::Max(float(Monitor->DetectionSphereBufferDistance) * 0.25f, 1.0f);
+	if (bNearbyQueried && Index.GetVersion() == NearbyQueryVersion
+		&& FVector::DistSquared(Location, NearbyQueryLocation) < RequeryDistance * RequeryDistance)
+	{
+		return;
+	}
+	bNearbyQueried = true;
+	NearbyQueryVersion = Index.GetVersion();
+	NearbyQueryLocation = Location;
+
+	TArray<UStreamableRootComponent *> InRange;
+	Index.FindWithinRadius(Location, InnerRadius, InRange);
+	TArray<UStreamableRootComponent *> ToStream;
+	for (UStreamableRootComponent *r : InRange)
+	{
+		// The client's own actor is streamed for the whole session.
+		if (r->GetOwner() == ClientActor.Get() || r->Priority < Monitor->MinimumPriority)
 		{
-			UStreamableRootComponent *streamableRootComponent = a->FindComponentByClass<UStreamableRootComponent>();
-			if (streamableRootComponent)
-			{
-				StreamToClient(streamableRootComponent);
-			}
+			continue;
+		}
+		if (!NearbyRoots.Contains(r))
+		{
+			ToStream.Add(r);
+		}
+	}
+	TArray<UStreamableRootComponent *> ToUnstream;
+	for (auto i = NearbyRoots.CreateIterator(); i; ++i)
+	{
+		UStreamableRootComponent *r = i->Get();
+		if (!r)
+		{
+			i.RemoveCurrent();
 		}
+		else if (!Index.IsWithinRadius(r, Location, OuterRadius))
+		{
+			ToUnstream.Add(r);
+			i.RemoveCurrent();
+		}
+	}
+	for (UStreamableRootComponent *r : ToStream)
+	{
+		StreamingQueue->Enqueue(r);
+		NearbyRoots.Add(r);
+	}
+	for (UStreamableRootComponent *r : ToUnstream)
+	{
+		// An actor that left before it was sent only needs to leave the queue.
+		if (!StreamingQueue->Remove(r))
+		{
+			UnstreamFromClient(r);
+		}
+	}
+	if (ToStream.Num() || ToUnstream.Num())
+	{
+		UE_LOG(LogTeleport, Verbose, TEXT("Client %llu: queued %d actors, unstreaming %d."), ClientID, ToStream.Num(), ToUnstream.Num());
+	}
+}
+
+void UTeleportSessionComponent::StreamQueuedNodes(float DeltaTime)
+{
+	if (!StreamingQueue || StreamingQueue->IsEmpty() || !ClientActor.IsValid() || !Monitor)
+	{
+		return;
+	}
+	// Order by what the client's head is nearest to and facing, once it has a head.
+	USceneComponent *Head = TeleportClientComponent ? TeleportClientComponent->HeadComponent : nullptr;
+	const FVector HeadLocation = Head ? Head->GetComponentLocation() : ClientActor->GetActorLocation();
+	const FVector HeadDirection = Head ? Head->GetForwardVector() : ClientActor->GetActorForwardVector();
+	// Released at the rate the server itself sends geometry.
+	const teleport::server::ServerSettings &ServerSettings = teleport::server::GetServerSettings();
+	TArray<UStreamableRootComponent *> ToStream;
+	StreamingQueue->Dequeue(HeadLocation, HeadDirection, DeltaTime, ServerSettings.throttleKpS, ServerSettings.geometryBufferCutoffSize, ToStream);
+	for (UStreamableRootComponent *r : ToStream)
+	{
+		StreamToClient(r);
 	}
 }
 
@@ -397,21 +471,6 @@ int UTeleportSessionComponent::GetPlayerId() const
 	return playerId;
 }
 
-void UTeleportSessionComponent::OnInnerSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
-{
-	if(IsStreaming)
-	{
-		TArray<UStreamableRootComponent*> OutComponents;
-		OtherActor->GetComponents(OutComponents,true); 
-		for (auto r : OutComponents)
-		{
-			StreamToClient(r);
-		}
-
-		UE_LOG(LogTeleport, Verbose, TEXT("\"%s\" overlapped with actor \"%s\"."), *OverlappedComponent->GetName(), *OtherActor->GetName());
-	}
-}
-
 avs::uid UTeleportSessionComponent::StreamToClient(UStreamableRootComponent *streamableRootComponent)
 {
 	//auto &cm = ClientManager::instance();
@@ -443,49 +502,6 @@ void UTeleportSessionComponent::UnstreamFromClient(UStreamableRootComponent *str
 	}
 }
 
-void UTeleportSessionComponent::OnOuterSphereEndOverlap(UPrimitiveComponent * OverlappedComponent, AActor * OtherActor, UPrimitiveComponent * OtherComp, int32 OtherBodyIndex)
-{
-	if(OtherActor==ClientActor)
-		return;
-	if(IsStreaming)
-	{
-		GeometrySource *geometrySource = ITeleport::Get().GetGeometrySource();
-		UStreamableRootComponent *streamableRootComponent=OtherActor->FindComponentByClass<UStreamableRootComponent>();
-		if (streamableRootComponent)
-		{ 
-			UnstreamFromClient(streamableRootComponent);
-		}
-	}
-}
-
-void UTeleportSessionComponent::AddDetectionSpheres()
-{
-	FAttachmentTransformRules transformRules = FAttachmentTransformRules(EAttachmentRule::KeepRelative, true);
-
-	//Attach streamable geometry detection spheres to player pawn.
-	{
-		DetectionSphereInner = NewObject<USphereComponent>(ClientActor.Get(), "InnerSphere");
-		DetectionSphereInner->OnComponentBeginOverlap.AddDynamic(this, &UTeleportSessionComponent::OnInnerSphereBeginOverlap);
-		DetectionSphereInner->SetCollisionProfileName("TeleportSensor");
-		DetectionSphereInner->SetGenerateOverlapEvents(true);
-		DetectionSphereInner->SetSphereRadius(Monitor->DetectionSphereRadius);
-
-		DetectionSphereInner->RegisterComponent();
-		DetectionSphereInner->AttachToComponent(ClientActor->GetRootComponent(), transformRules);
-	}
-
-	{
-		DetectionSphereOuter = NewObject<USphereComponent>(ClientActor.Get(), "OuterSphere");
-		DetectionSphereOuter->OnComponentEndOverlap.AddDynamic(this, &UTeleportSessionComponent::OnOuterSphereEndOverlap);
-		DetectionSphereOuter->SetCollisionProfileName("TeleportSensor");
-		DetectionSphereOuter->SetGenerateOverlapEvents(true);
-		DetectionSphereOuter->SetSphereRadius(Monitor->DetectionSphereRadius + Monitor->DetectionSphereBufferDistance);
-
-		DetectionSphereOuter->RegisterComponent();
-		DetectionSphereOuter->AttachToComponent(ClientActor->GetRootComponent(), transformRules);
-	}
-}
-
 void UTeleportSessionComponent::ApplyPlayerInput(float DeltaTime)
 {
 /*	check(PlayerController.IsValid());
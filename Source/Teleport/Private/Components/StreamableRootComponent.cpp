@@ -6,21 +6,22 @@
 #include "GeometrySource.h"
 #include "Teleport.h"
 #include "TeleportModule.h"
+#include "TeleportMonitor.h"
 #include "Engine.h"
 
 // Sets default values for this component's properties
 UStreamableRootComponent::UStreamableRootComponent()
 {
-	PrimaryComponentTick.bStartWithTickEnabled = false; 
-	PrimaryComponentTick.bCanEverTick = true;
+	// Nothing is done per frame: movable actors are tracked through their transform-updated events.
+	PrimaryComponentTick.bCanEverTick = false;
 	Priority=0;
 }
 
 // Called when the game starts or when the StreamableNode object is needed in editing.
-bool UStreamableRootComponent::AddSceneComponentStreamableNode(USceneComponent *sc)
+UStreamableNode *UStreamableRootComponent::FindOrAddStreamableNode(USceneComponent *sc)
 {
 	if (!sc)
-		return false;
+		return nullptr;
 	TWeakObjectPtr<UStreamableNode> streamableNode=streamableNodes.FindOrAdd(sc);
 	if(!streamableNode.Get())
 	{
@@ -31,8 +32,16 @@ bool UStreamableRootComponent::AddSceneComponentStreamableNode(USceneComponent *
 		streamableNode=n;
 		streamableNodes[sc]=Nodes[Nodes.Num()-1];
 	}
+	return streamableNode.Get();
+}
+
+bool UStreamableRootComponent::AddSceneComponentStreamableNode(USceneComponent *sc)
+{
+	UStreamableNode *streamableNode=FindOrAddStreamableNode(sc);
+	if (!streamableNode)
+		return false;
 	GeometrySource *geometrySource=ITeleport::Get().GetGeometrySource();
-	geometrySource->AddNode(streamableNode.Get(),true);
+	geometrySource->AddNode(streamableNode,true);
 	bool result=(streamableNode->GetUid().Value!=0);
 	return result;
 }
@@ -42,16 +51,68 @@ void UStreamableRootComponent::BeginPlay()
 	Super::BeginPlay();
 	AActor *actor = GetOwner();
 
-	// Detect any motion:
-	GEngine->OnActorMoved().AddUObject(this, &UStreamableRootComponent::OnMoved);
+	// Only worlds that use Teleport have a monitor; one isn't created here. If it's created later, it adds this itself.
+	AddToMonitor(ATeleportMonitor::Find(GetWorld()));
+	// Movable actors must keep their place in the spatial index up to date, even before their nodes are streamed.
+	USceneComponent *root = actor ? actor->GetRootComponent() : nullptr;
+	if (!root)
+	{
+		return;
+	}
+	TArray<USceneComponent*> components;
+	root->GetChildrenComponents(true, components);
+	components.Insert(root, 0);
+	for (USceneComponent *sc : components)
+	{
+		if (sc && sc->Mobility == EComponentMobility::Movable)
+		{
+			MovableComponents.Add(sc, sc->TransformUpdated.AddUObject(this, &UStreamableRootComponent::OnMovableTransformUpdated));
+		}
+	}
 }
 
+void UStreamableRootComponent::AddToMonitor(ATeleportMonitor *m)
+{
+	if (!m || Monitor.IsValid())
+	{
+		return;
+	}
+	Monitor = m;
+	Monitor->StreamableIndex.Add(this);
+}
 
-void UStreamableRootComponent::OnMoved(AActor* Actor)
+void UStreamableRootComponent::OnMovableTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
 {
-    UE_LOG(LogTemp, Warning, TEXT("Level actor moved"));
+	if (Monitor.IsValid())
+	{
+		Monitor->StreamableIndex.MarkMoved(this);
+	}
 }
 
+void UStreamableRootComponent::EndPlay(const EEndPlayReason::Type Reason)
+{
+	GeometrySource *geometrySource=ITeleport::Get().GetGeometrySource();
+	for(auto n:streamableNodes)
+	{
+		geometrySource->UntrackNodeTransform(n.Value.Get());
+	}
+	for (auto &m : MovableComponents)
+	{
+		if (USceneComponent *sc = m.Key.Get())
+		{
+			sc->TransformUpdated.Remove(m.Value);
+		}
+	}
+	MovableComponents.Empty();
+	if (Monitor.IsValid())
+	{
+		Monitor->StreamableIndex.Remove(this);
+	}
+	Monitor.Reset();
+	Super::EndPlay(Reason);
+}
+
+
 void UStreamableRootComponent::InitializeStreamableNodes() 
 {
 	if(nodesInitialized)
@@ -72,18 +133,31 @@ void UStreamableRootComponent::InitializeStreamableNodes()
 		UE_LOG(LogTeleport, Error, TEXT("UStreamableRootComponent::InitializeStreamableNodes: Null root USceneComponent!"));
 		return;
 	}
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
 	bool stationary=root->Mobility!=EComponentMobility::Type::Movable;
-	PrimaryComponentTick.bCanEverTick = !stationary;
-	SetComponentTickEnabled(!stationary);
-	bool result=AddSceneComponentStreamableNode(root);
 	TArray<USceneComponent*> children;
 	root->GetChildrenComponents(true,children);
+	// Create all the nodes first, so their meshes can be extracted together, in parallel.
+	TArray<UStreamableNode*> newNodes;
+	newNodes.Add(FindOrAddStreamableNode(root));
+	for(int i=0;i<children.Num();i++)
+	{
+		newNodes.Add(FindOrAddStreamableNode(children[i]));
+	}
+	GeometrySource *geometrySource=ITeleport::Get().GetGeometrySource();
+	geometrySource->ExtractMeshes(newNodes,false);
+	bool result=AddSceneComponentStreamableNode(root);
 	for(int i=0;i<children.Num();i++)
 	{
 		result&=AddSceneComponentStreamableNode(children[i]);
 	}
+	// The geometry source sends the transforms of movable nodes when they move.
+	if(!stationary)
+	{
+		for(UStreamableNode *n:newNodes)
+		{
+			geometrySource->TrackNodeTransform(n);
+		}
+	}
 	nodesInitialized=result;
 }
 
@@ -100,18 +174,3 @@ void UStreamableRootComponent::OnRegister()
 	nodesInitialized=false;
 	Super::OnRegister();
 }
-
-// Called every frame
-void UStreamableRootComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-	GeometrySource *geometrySource=ITeleport::Get().GetGeometrySource();
-	// Call GeometrySource::UpdateNode() on all our streamable nodes.
-	for(auto n:streamableNodes)
-	{
-		geometrySource->UpdateNode(n.Value.Get());
-	}
-	#if WITH_EDITOR
-	#endif
-}
-
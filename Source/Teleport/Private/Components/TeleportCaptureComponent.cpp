@@ -7,6 +7,10 @@
 #if 1
 #include "Engine.h"
 #include "Engine/GameViewportClient.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/TextureRenderTargetCube.h"
+#include "Math/VectorRegister.h"
 #include "GameFramework/Actor.h"
 #include "Pipelines/EncodePipelineMonoscopic.h"
 #include "TeleportModule.h"
@@ -16,6 +20,7 @@
 
 UTeleportCaptureComponent::UTeleportCaptureComponent()
 	: bRenderOwner(false)
+	, FaceCaptureComponent(nullptr)
 	, TeleportReflectionCaptureComponent(nullptr)
 	, bIsStreaming(false)
 	, bSendKeyframe(false)
@@ -71,6 +76,12 @@ void UTeleportCaptureComponent::BeginPlay()
 
 void UTeleportCaptureComponent::EndPlay(const EEndPlayReason::Type Reason)
 {
+	if (FaceCaptureComponent)
+	{
+		FaceCaptureComponent->DestroyComponent();
+		FaceCaptureComponent = nullptr;
+	}
+	FaceRenderTargets.Empty();
 	Super::EndPlay(Reason);
 }
 
@@ -120,25 +131,25 @@ void UTeleportCaptureComponent::UpdateSceneCaptureContents(FSceneInterface* Scen
 		return;
 
 	ATeleportMonitor* Monitor = ATeleportMonitor::Instantiate(GetWorld());
-	if(Monitor && Monitor->VideoEncodeFrequency > 1)
+	if(!Monitor)
 	{
-		static int u = 1;
-		u--;
-		u = std::min(Monitor->VideoEncodeFrequency, u);
-		if(!u)
-		{
-			u = Monitor->VideoEncodeFrequency;
-		}
-		else
+		return;
+	}
+	// A client that shares another's capture is encoded when the other's capture is rendered.
+	if(!CaptureLeader.IsExplicitlyNull())
+	{
+		if(CaptureLeader.IsValid() && CaptureLeader->bIsStreaming && Monitor->bShareCaptures)
 		{
 			return;
 		}
+		// The leader has stopped streaming, or was destroyed without releasing this client.
+		SetCaptureLeader(nullptr, Monitor);
 	}
-
-	if(Monitor->bDoCubemapCulling)
+	if(!Monitor->EncodeScheduler.ShouldEncode(clientId, Monitor->VideoEncodeFrequency, Monitor->TargetFPS))
 	{
-		CullHiddenCubeSegments();
+		return;
 	}
+	UpdateCaptureGroup(Monitor);
 
 	// Aidan: The parent function belongs to SceneCaptureComponentCube and is located in SceneCaptureComponent.cpp. 
 	// The parent function calls UpdateSceneCaptureContents function in SceneCaptureRendering.cpp.
@@ -146,32 +157,148 @@ void UTeleportCaptureComponent::UpdateSceneCaptureContents(FSceneInterface* Scen
 	// The parent function is called from the static function UpdateDeferredCaptures located in
 	// SceneCaptureComponent.cpp. UpdateDeferredCaptures is called by the BeginRenderingViewFamily function in SceneRendering.cpp.
 	// Therefore the rendering commands queued after this function call below directly follow the scene capture cube's commands in the queue.
-	Super::UpdateSceneCaptureContents(Scene);
+	// When culling, the faces are rendered one at a time instead, which likewise enqueues their commands immediately.
+	if(Monitor->bDoCubemapCulling && TextureTarget)
+	{
+		CullHiddenCubeSegments(ClientCamInfo, false);
+		// The capture must include everything that the clients sharing it can see.
+		for(const auto& Follower : CaptureFollowers)
+		{
+			if(Follower.IsValid())
+			{
+				CullHiddenCubeSegments(Follower->ClientCamInfo, true);
+			}
+		}
+		CaptureVisibleFaces(Scene);
+	}
+	else
+	{
+		Super::UpdateSceneCaptureContents(Scene);
+	}
 
 	if(Monitor->bStreamVideo && TextureTarget)
 	{
 		FTransform Transform = GetComponentTransform();
+		PrepareVideoFrame(Scene, TextureTarget, Transform, QuadsToRender);
+		EncodeVideoFrame(Scene, TextureTarget, Transform);
+		for(const auto& Follower : CaptureFollowers)
+		{
+			if(Follower.IsValid())
+			{
+				Follower->EncodeSharedFrame(Scene, this);
+			}
+		}
+	}
+}
+
+void UTeleportCaptureComponent::PrepareVideoFrame(FSceneInterface* Scene, UTextureRenderTargetCube* Cubemap, FTransform& Transform, const TArray<bool>& BlockFlags)
+{
+	EncodePipeline->PrepareFrame(Scene, Cubemap, Transform, BlockFlags);
+	if(TeleportReflectionCaptureComponent && EncodeParams.bDecomposeCube)
+	{
+		TeleportReflectionCaptureComponent->UpdateContents(
+			Scene->GetRenderScene(),
+			Cubemap,
+			Scene->GetFeatureLevel(),
+			Transform.GetLocation(),
+			EncodePipeline->GetTimings());
+		int32 W = Cubemap->GetSurfaceWidth();
+		FIntPoint Offset0((W * 3) / 2, W * 2);
+		TeleportReflectionCaptureComponent->PrepareFrame(
+			Scene->GetRenderScene(),
+			EncodePipeline->GetSurfaceTexture(),
+			Scene->GetFeatureLevel(), Offset0,
+			EncodePipeline->GetTimings());
+	}
+}
+
+void UTeleportCaptureComponent::EncodeVideoFrame(FSceneInterface* Scene, UTextureRenderTargetCube* Cubemap, FTransform& Transform)
+{
+	EncodePipeline->EncodeFrame(Scene, Cubemap, Transform, bSendKeyframe);
+	// The client must request it again if it needs it
+	bSendKeyframe = false;
+}
 
-		EncodePipeline->PrepareFrame(Scene, TextureTarget, Transform, QuadsToRender);
-		if(TeleportReflectionCaptureComponent && EncodeParams.bDecomposeCube)
+void UTeleportCaptureComponent::UpdateCaptureGroup(ATeleportMonitor* Monitor)
+{
+	const float MaxDistance = Monitor->bShareCaptures ? Monitor->CaptureSharingDistance : -1.0f;
+	for(int32 i = CaptureFollowers.Num() - 1; i >= 0; i--)
+	{
+		UTeleportCaptureComponent* Follower = CaptureFollowers[i].Get();
+		if(!Follower || !Follower->CanFollowCapture(this, MaxDistance))
+		{
+			if(Follower)
+			{
+				Follower->SetCaptureLeader(nullptr, Monitor);
+			}
+			CaptureFollowers.RemoveAt(i);
+		}
+	}
+	if(!Monitor->bShareCaptures)
+	{
+		return;
+	}
+	for(const auto& Candidate : Monitor->StreamingCaptureComponents)
+	{
+		UTeleportCaptureComponent* Other = Candidate.Get();
+		// A client that's already leading or following can't join another group.
+		if(Other && Other != this && !Other->CaptureLeader.IsValid() && !Other->CaptureFollowers.Num() && Other->CanFollowCapture(this, MaxDistance))
 		{
-			TeleportReflectionCaptureComponent->UpdateContents(
-				Scene->GetRenderScene(),
-				TextureTarget,
-				Scene->GetFeatureLevel());
-			int32 W = TextureTarget->GetSurfaceWidth();
-			FIntPoint Offset0((W * 3) / 2, W * 2);
-			TeleportReflectionCaptureComponent->PrepareFrame(
-				Scene->GetRenderScene(),
-				EncodePipeline->GetSurfaceTexture(),
-				Scene->GetFeatureLevel(), Offset0);
+			Other->SetCaptureLeader(this, Monitor);
+			CaptureFollowers.Add(Other);
 		}
-		EncodePipeline->EncodeFrame(Scene, TextureTarget, Transform, bSendKeyframe);
-		// The client must request it again if it needs it
-		bSendKeyframe = false;
 	}
 }
 
+bool UTeleportCaptureComponent::CanFollowCapture(const UTeleportCaptureComponent* Leader, float MaxDistance) const
+{
+	if(!bIsStreaming || !Leader->bIsStreaming || !TextureTarget || !Leader->TextureTarget || !EncodePipeline)
+	{
+		return false;
+	}
+	if(TextureTarget->GetSurfaceWidth() != Leader->TextureTarget->GetSurfaceWidth() || EncodeParams.bDecomposeCube != Leader->EncodeParams.bDecomposeCube)
+	{
+		return false;
+	}
+	return FVector::DistSquared(GetComponentLocation(), Leader->GetComponentLocation()) <= FMath::Square(MaxDistance) && MaxDistance >= 0.0f;
+}
+
+void UTeleportCaptureComponent::SetCaptureLeader(UTeleportCaptureComponent* Leader, ATeleportMonitor* Monitor)
+{
+	// A leader that was destroyed leaves a stale pointer, which must still be reset.
+	const bool bStaleLeader = !CaptureLeader.IsValid() && !CaptureLeader.IsExplicitlyNull();
+	if(Leader == CaptureLeader.Get() && !bStaleLeader)
+	{
+		return;
+	}
+	// While following, this client is encoded along with its leader, so it's not scheduled by itself.
+	if(Leader)
+	{
+		Monitor->EncodeScheduler.RemoveClient(clientId);
+	}
+	else if(bIsStreaming)
+	{
+		Monitor->EncodeScheduler.AddClient(clientId);
+	}
+	CaptureLeader = Leader;
+}
+
+void UTeleportCaptureComponent::EncodeSharedFrame(FSceneInterface* Scene, UTeleportCaptureComponent* Leader)
+{
+	if(!EncodePipeline || !Leader->EncodePipeline)
+	{
+		return;
+	}
+	// The cubemap was captured from the leader's position, so the frame is sent with the leader's transform.
+	FTransform Transform = Leader->GetComponentTransform();
+	// Where the streams match, the leader's prepared frame, reflections included, is copied as it is.
+	if(!EncodePipeline->CopyFrame(Leader->EncodePipeline.get()))
+	{
+		PrepareVideoFrame(Scene, Leader->TextureTarget, Transform, Leader->QuadsToRender);
+	}
+	EncodeVideoFrame(Scene, Leader->TextureTarget, Transform);
+}
+
 bool UTeleportCaptureComponent::ShouldRenderFace(int32 FaceId) const
 {
 	if (FacesToRender.Num() <= FaceId)
@@ -181,101 +308,287 @@ bool UTeleportCaptureComponent::ShouldRenderFace(int32 FaceId) const
 	return FacesToRender[FaceId];
 }
 
-void UTeleportCaptureComponent::CullHiddenCubeSegments()
+// The view rotation of each face of a cube capture. This matches the engine's cube capture,
+// so that faces rendered one at a time land where the cube capture would have put them.
+static FMatrix CalcCubeFaceViewRotation(ECubeFace Face)
+{
+	FVector Up = FVector::YAxisVector;
+	FVector Dir;
+	switch (Face)
+	{
+	case CubeFace_PosX:
+		Dir = FVector::XAxisVector;
+		break;
+	case CubeFace_NegX:
+		Dir = -FVector::XAxisVector;
+		break;
+	case CubeFace_PosY:
+		Up = -FVector::ZAxisVector;
+		Dir = FVector::YAxisVector;
+		break;
+	case CubeFace_NegY:
+		Up = FVector::ZAxisVector;
+		Dir = -FVector::YAxisVector;
+		break;
+	case CubeFace_PosZ:
+		Dir = FVector::ZAxisVector;
+		break;
+	case CubeFace_NegZ:
+	default:
+		Dir = -FVector::ZAxisVector;
+		break;
+	}
+	return FBasisVectorMatrix(Up ^ Dir, Up, Dir, FVector::ZeroVector);
+}
+
+// The world rotation that makes a 2D capture look along the given face of the cube.
+static FQuat GetCubeFaceCaptureRotation(ECubeFace Face)
+{
+	// A 2D capture's view rotation is the inverse of its rotation, followed by this swap from Unreal's axes to view axes.
+	static const FMatrix ViewAxes(FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
+	return FQuat(ViewAxes * CalcCubeFaceViewRotation(Face).GetTransposed());
+}
+
+// The 90 degree projection of a cube face, narrowed to the given rectangle of the face's texels.
+static FMatrix GetFaceRectProjection(const FIntRect& Rect, int32 FaceWidth)
+{
+	const float HalfFOV = PI / 4.0f;
+	const FMatrix FaceProjection = FReversedZPerspectiveMatrix(HalfFOV, HalfFOV, 1.0f, 1.0f, GNearClippingPlane, GNearClippingPlane);
+	// Scale and offset clip space so that the rectangle fills the view. Texel y runs down, clip space y runs up.
+	const FVector2D Min(2.0 * Rect.Min.X / FaceWidth - 1.0, 1.0 - 2.0 * Rect.Max.Y / FaceWidth);
+	const FVector2D Max(2.0 * Rect.Max.X / FaceWidth - 1.0, 1.0 - 2.0 * Rect.Min.Y / FaceWidth);
+	const FVector2D Scale = FVector2D(2.0, 2.0) / (Max - Min);
+	const FVector2D Centre = (Min + Max) * 0.5;
+	FMatrix RectMatrix = FMatrix::Identity;
+	RectMatrix.M[0][0] = Scale.X;
+	RectMatrix.M[1][1] = Scale.Y;
+	RectMatrix.M[3][0] = -Scale.X * Centre.X;
+	RectMatrix.M[3][1] = -Scale.Y * Centre.Y;
+	return FaceProjection * RectMatrix;
+}
+
+void UTeleportCaptureComponent::CaptureVisibleFaces(FSceneInterface* Scene)
 {
-	assert(CubeQuads.Num >= 6);
+	if (!FaceCaptureComponent)
+	{
+		FaceCaptureComponent = NewObject<USceneCaptureComponent2D>(this, TEXT("TeleportFaceCapture"));
+		FaceCaptureComponent->bCaptureEveryFrame = false;
+		FaceCaptureComponent->bCaptureOnMovement = false;
+		FaceCaptureComponent->bUseCustomProjectionMatrix = true;
+		FaceCaptureComponent->PostProcessBlendWeight = 0.0f;
+		FaceCaptureComponent->SetUsingAbsoluteLocation(true);
+		FaceCaptureComponent->SetUsingAbsoluteRotation(true);
+		FaceCaptureComponent->RegisterComponentWithWorld(GetWorld());
+	}
+	// Render exactly what the cube capture would.
+	FaceCaptureComponent->CaptureSource = CaptureSource;
+	FaceCaptureComponent->ShowFlags = ShowFlags;
+	FaceCaptureComponent->PrimitiveRenderMode = PrimitiveRenderMode;
+	FaceCaptureComponent->HiddenActors = HiddenActors;
+	FaceCaptureComponent->HiddenComponents = HiddenComponents;
+	FaceCaptureComponent->ShowOnlyActors = ShowOnlyActors;
+	FaceCaptureComponent->ShowOnlyComponents = ShowOnlyComponents;
+	FaceCaptureComponent->LODDistanceFactor = LODDistanceFactor;
+	FaceCaptureComponent->MaxViewDistanceOverride = MaxViewDistanceOverride;
+
+	const int32 W = TextureTarget->GetSurfaceWidth();
+	const FVector Location = GetComponentLocation();
+	FTextureRenderTargetResource* CubeResource = TextureTarget->GameThread_GetRenderTargetResource();
+	for (int32 FaceId = 0; FaceId < CubeFace_MAX; ++FaceId)
+	{
+		const FIntRect Rect = GetVisibleFaceRect(FaceId);
+		if (Rect.IsEmpty())
+		{
+			continue;
+		}
+		UTextureRenderTarget2D* FaceTarget = GetFaceRenderTarget(Rect.Size());
+		FQuat Rotation = GetCubeFaceCaptureRotation((ECubeFace)FaceId);
+		if (bCaptureRotation)
+		{
+			Rotation = GetComponentQuat() * Rotation;
+		}
+		FaceCaptureComponent->TextureTarget = FaceTarget;
+		FaceCaptureComponent->CustomProjectionMatrix = GetFaceRectProjection(Rect, W);
+		FaceCaptureComponent->SetWorldLocationAndRotation(Location, Rotation);
+		FaceCaptureComponent->UpdateSceneCaptureContents(Scene);
+
+		FTextureRenderTargetResource* FaceResource = FaceTarget->GameThread_GetRenderTargetResource();
+		ENQUEUE_RENDER_COMMAND(TeleportCopyCubeFace)(
+			[FaceResource, CubeResource, FaceId, Rect](FRHICommandListImmediate& RHICmdList)
+			{
+				FRHITexture* FaceTexture = FaceResource->GetRenderTargetTexture();
+				FRHITexture* CubeTexture = CubeResource->GetRenderTargetTexture();
+				FRHICopyTextureInfo CopyTextureInfo;
+				CopyTextureInfo.Size = FIntVector(Rect.Width(), Rect.Height(), 1);
+				CopyTextureInfo.DestPosition = FIntVector(Rect.Min.X, Rect.Min.Y, 0);
+				CopyTextureInfo.DestSliceIndex = FaceId;
+				RHICmdList.Transition({ FRHITransitionInfo(FaceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc), FRHITransitionInfo(CubeTexture, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+				RHICmdList.CopyTexture(FaceTexture, CubeTexture, CopyTextureInfo);
+				RHICmdList.Transition({ FRHITransitionInfo(FaceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask), FRHITransitionInfo(CubeTexture, ERHIAccess::CopyDest, ERHIAccess::SRVMask) });
+			});
+	}
+}
+
+FIntRect UTeleportCaptureComponent::GetVisibleFaceRect(int32 FaceId) const
+{
+	const int32 W = TextureTarget->GetSurfaceWidth();
+	const int32 N = CubeCorners.BlocksPerFaceAcross;
+	if (!ShouldRenderFace(FaceId))
+	{
+		return FIntRect();
+	}
+	if (N <= 0 || QuadsToRender.Num() < CubeCorners.NumBlocks)
+	{
+		return FIntRect(0, 0, W, W);
+	}
+	// Block (j, k) of a face is j blocks from the left and k blocks up from the bottom, as in DecomposeCS.
+	int32 MinJ = N, MaxJ = -1, MinK = N, MaxK = -1;
+	const int32 Base = FaceId * N * N;
+	for (int32 j = 0; j < N; ++j)
+	{
+		for (int32 k = 0; k < N; ++k)
+		{
+			if (QuadsToRender[Base + j * N + k])
+			{
+				MinJ = FMath::Min(MinJ, j);
+				MaxJ = FMath::Max(MaxJ, j);
+				MinK = FMath::Min(MinK, k);
+				MaxK = FMath::Max(MaxK, k);
+			}
+		}
+	}
+	if (MaxJ < 0)
+	{
+		return FIntRect();
+	}
+	// The last block in each direction takes any remainder of the face.
+	const int32 BlockSize = W / N;
+	auto Edge = [BlockSize, N, W](int32 i) { return i >= N ? W : i * BlockSize; };
+	FIntRect Rect(Edge(MinJ), W - Edge(MaxK + 1), Edge(MaxJ + 1), W - Edge(MinK));
+
+	// Round the size up to a multiple of a quarter face, so that only a few sizes of render target are ever needed.
+	const int32 Quarter = FMath::Max(W / 4, 1);
+	FIntPoint Size = Rect.Size();
+	Size.X = FMath::Min(FMath::DivideAndRoundUp(Size.X, Quarter) * Quarter, W);
+	Size.Y = FMath::Min(FMath::DivideAndRoundUp(Size.Y, Quarter) * Quarter, W);
+	Rect.Min.X = FMath::Min(Rect.Min.X, W - Size.X);
+	Rect.Min.Y = FMath::Min(Rect.Min.Y, W - Size.Y);
+	Rect.Max = Rect.Min + Size;
+	return Rect;
+}
+
+UTextureRenderTarget2D* UTeleportCaptureComponent::GetFaceRenderTarget(FIntPoint Size)
+{
+	UTextureRenderTarget2D*& FaceTarget = FaceRenderTargets.FindOrAdd(Size);
+	if (!FaceTarget)
+	{
+		FaceTarget = NewObject<UTextureRenderTarget2D>(this);
+		FaceTarget->InitCustomFormat(Size.X, Size.Y, TextureTarget->GetFormat(), TextureTarget->bForceLinearGamma);
+	}
+	return FaceTarget;
+}
+
+void UTeleportCaptureComponent::CullHiddenCubeSegments(const teleport::server::CameraInfo& CamInfo, bool bAccumulate)
+{
+	check(CubeCorners.NumBlocks >= 6);
 
 	// Aidan: Currently not going to do this on GPU because doing it on game thread allows us to  
 	// share the output with the capture component to cull faces from rendering.
 	ATeleportMonitor *Monitor = ATeleportMonitor::Instantiate(GetWorld());
 
-	FQuat UnrealOrientation = FQuat(ClientCamInfo.orientation.x, ClientCamInfo.orientation.y, ClientCamInfo.orientation.z, ClientCamInfo.orientation.w);
+	FQuat UnrealOrientation = FQuat(CamInfo.orientation.x, CamInfo.orientation.y, CamInfo.orientation.z, CamInfo.orientation.w);
 	const FVector LookAt = UnrealOrientation.GetForwardVector() * 10;
 	const FVector Up = UnrealOrientation.GetUpVector();
 	const FLookAtMatrix ViewMatrix = FLookAtMatrix(FVector::ZeroVector, LookAt, Up);
 
-	// Convert FOV from degrees to radians 
-	const float FOV = FMath::DegreesToRadians(ClientCamInfo.fov);
+	// Convert FOV from degrees to radians, widened by the margin so that the client can turn a little before the frame arrives.
+	const float FOV = FMath::DegreesToRadians(FMath::Min(CamInfo.fov + Monitor->CubemapCullingMargin, 89.0f));
 
 	FMatrix ProjectionMatrix;
 	if (static_cast<int32>(ERHIZBuffer::IsInverted) == 1)
 	{
-		ProjectionMatrix = AdjustProjectionMatrixForRHI(FReversedZPerspectiveMatrix(FOV, ClientCamInfo.width, ClientCamInfo.height, 0, 0));
+		ProjectionMatrix = AdjustProjectionMatrixForRHI(FReversedZPerspectiveMatrix(FOV, CamInfo.width, CamInfo.height, 0, 0));
 	}
 	else
 	{
-		ProjectionMatrix = AdjustProjectionMatrixForRHI(FPerspectiveMatrix(FOV, ClientCamInfo.width, ClientCamInfo.height, 0, 0));
+		ProjectionMatrix = AdjustProjectionMatrixForRHI(FPerspectiveMatrix(FOV, CamInfo.width, CamInfo.height, 0, 0));
 	}
 
 	const FMatrix VP = ViewMatrix * ProjectionMatrix;
 
-	// Use to prevent shared vectors from being tested more than once
-	TMap<FVector, bool> VectorIntersectionMap;
-
-	const uint32 BlocksPerFace = Monitor->BlocksPerCubeFaceAcross * Monitor->BlocksPerCubeFaceAcross;
+	// A point is in the frustum if, in clip space, -w <= x <= w, -w <= y <= w and w > 0.
+	// Each of these is a plane in view space, made from VP's columns, with the inside where the plane equation is positive.
+	// The projection has no far plane, so only five of the usual six planes apply.
+	static constexpr int32 NumPlanes = 5;
+	VectorRegister4Float Planes[NumPlanes][4];
+	{
+		auto Column = [&VP](int32 c) { return FVector4(VP.M[0][c], VP.M[1][c], VP.M[2][c], VP.M[3][c]); };
+		const FVector4 CX = Column(0);
+		const FVector4 CY = Column(1);
+		const FVector4 CW = Column(3);
+		const FVector4 PlaneEquations[NumPlanes] = { CW + CX, CW - CX, CW + CY, CW - CY, CW };
+		for (int32 p = 0; p < NumPlanes; ++p)
+		{
+			for (int32 c = 0; c < 4; ++c)
+			{
+				Planes[p][c] = VectorSetFloat1((float)PlaneEquations[p][c]);
+			}
+		}
+	}
+	const VectorRegister4Float Zero = VectorZeroFloat();
 
-	const FVector* Vertices = reinterpret_cast<FVector*>(&CubeQuads[0]);
+	const int32 NumBlocks = CubeCorners.NumBlocks;
+	const int32 BlocksPerFace = CubeCorners.BlocksPerFaceAcross * CubeCorners.BlocksPerFaceAcross;
+	const float* X = CubeCorners.X.GetData();
+	const float* Y = CubeCorners.Y.GetData();
+	const float* Z = CubeCorners.Z.GetData();
+	const bool bDebugCull = Monitor->CullQuadIndex >= 0 && Monitor->CullQuadIndex < NumBlocks;
 
 	// Iterate through all six faces
-	for (uint32 i = 0; i < 6; ++i)
+	for (int32 i = 0; i < 6; ++i)
 	{
 		bool FaceIntersects = false;
 
-		// Iterate through each of the face's quads
-		for (uint32 j = 0; j < BlocksPerFace; ++j)
+		for (int32 j = 0; j < BlocksPerFace; ++j)
 		{
-			uint32 QuadIndex = i * BlocksPerFace + j;
-
-			bool Intersects = false;
-
-			// Iterate through each of the quad's vertices
-			for (uint32 k = 0; k < 4; ++k)
+			const int32 QuadIndex = i * BlocksPerFace + j;
+			const VectorRegister4Float BX = VectorLoad(X + QuadIndex * 4);
+			const VectorRegister4Float BY = VectorLoad(Y + QuadIndex * 4);
+			const VectorRegister4Float BZ = VectorLoad(Z + QuadIndex * 4);
+
+			// A block is culled only if all four of its corners are outside the same plane. This is conservative:
+			// a block that straddles the frustum, even with no corner inside it, is kept.
+			bool Intersects = true;
+			for (int32 p = 0; p < NumPlanes; ++p)
 			{
-				uint32 VIndex = (QuadIndex * 4) + k;
-				const auto& V = Vertices[VIndex];
-				const bool* Value = VectorIntersectionMap.Find(V);
-				if (Value && *Value)
+				VectorRegister4Float Distance = VectorMultiplyAdd(BX, Planes[p][0], Planes[p][3]);
+				Distance = VectorMultiplyAdd(BY, Planes[p][1], Distance);
+				Distance = VectorMultiplyAdd(BZ, Planes[p][2], Distance);
+				if (VectorMaskBits(VectorCompareLT(Distance, Zero)) == 0xF)
 				{
-					Intersects = true;
+					Intersects = false;
 					break;
 				}
-				else
-				{
-					if (VectorIntersectsFrustum(V, VP))
-					{
-						Intersects = true;
-						VectorIntersectionMap.Add(TPair<FVector, bool>(V, true));
-						break;
-					}
-					VectorIntersectionMap.Add(TPair<FVector, bool>(V, false));
-				}
 			}
 
 			// For debugging only! Cull only the quad selected by the user 
-			if (Monitor->CullQuadIndex >= 0 && Monitor->CullQuadIndex < CubeQuads.Num())
+			if (bDebugCull)
 			{
-				if (QuadIndex == Monitor->CullQuadIndex)
-				{
-					Intersects = false;
-				}
-				else
-				{
-					Intersects = true;
-				}
+				Intersects = QuadIndex != Monitor->CullQuadIndex;
 			}
 
-			QuadsToRender[QuadIndex] = Intersects;
-
-			if (Intersects)
+			if (bAccumulate)
 			{
-				FaceIntersects = true;
+				Intersects |= QuadsToRender[QuadIndex];
 			}
+			QuadsToRender[QuadIndex] = Intersects;
+			FaceIntersects |= Intersects;
 		}
 		FacesToRender[i] = FaceIntersects;
 	}
 }
 
-void UTeleportCaptureComponent::CreateCubeQuads(TArray<FQuad>& Quads, uint32 BlocksPerFaceAcross, float CubeWidth)
+void UTeleportCaptureComponent::CreateCubeQuads(FCubeBlockCorners& Corners, uint32 BlocksPerFaceAcross, float CubeWidth)
 {
 	const float HalfWidth = CubeWidth / 2;
 	const float QuadSize = CubeWidth / (float)BlocksPerFaceAcross;
@@ -296,10 +609,22 @@ void UTeleportCaptureComponent::CreateCubeQuads(TArray<FQuad>& Quads, uint32 Blo
 
 	static const FQuat FaceQuats[6] = { FrontQuat, BackQuat, RightQuat, LeftQuat, TopQuat, BottomQuat };
 
-	const uint32 NumQuads = BlocksPerFaceAcross * BlocksPerFaceAcross * 6;
+	const int32 NumQuads = BlocksPerFaceAcross * BlocksPerFaceAcross * 6;
+
+	Corners.BlocksPerFaceAcross = BlocksPerFaceAcross;
+	Corners.NumBlocks = NumQuads;
+	Corners.X.SetNumUninitialized(NumQuads * 4);
+	Corners.Y.SetNumUninitialized(NumQuads * 4);
+	Corners.Z.SetNumUninitialized(NumQuads * 4);
 
-	Quads.Empty();
-	Quads.Reserve(NumQuads);
+	int32 n = 0;
+	auto AddCorner = [&Corners, &n](const FVector& V)
+	{
+		Corners.X[n] = (float)V.X;
+		Corners.Y[n] = (float)V.Y;
+		Corners.Z[n] = (float)V.Z;
+		++n;
+	};
 
 	// Iterate through all six faces
 	for (uint32 i = 0; i < 6; ++i)
@@ -316,49 +641,18 @@ void UTeleportCaptureComponent::CreateCubeQuads(TArray<FQuad>& Quads, uint32 Blo
 			// Go up
 			for (uint32 k = 0; k < BlocksPerFaceAcross; ++k)
 			{
-				FQuad Quad;
-				Quad.BottomLeft = QuadPos;
-				Quad.TopLeft = QuadPos + UpVec;
-				Quad.BottomRight = QuadPos + RightVec;
-				Quad.TopRight = Quad.TopLeft + RightVec;
-
-				QuadPos = Quad.TopLeft;
-
-				Quads.Emplace(MoveTemp(Quad));
+				const FVector TopLeft = QuadPos + UpVec;
+				AddCorner(QuadPos);
+				AddCorner(TopLeft);
+				AddCorner(QuadPos + RightVec);
+				AddCorner(TopLeft + RightVec);
+				QuadPos = TopLeft;
 			}
 			Pos += RightVec;
 		}
 	}
 }
 
-bool UTeleportCaptureComponent::VectorIntersectsFrustum(const FVector& Vector, const FMatrix& ViewProjection)
-{
-	FPlane Result = ViewProjection.TransformFVector4(FVector4(Vector, 1.0f));
-	if (Result.W <= 0.0f)
-	{
-		return false;
-	}
-	// the result of this will be x and y coords in -1..1 projection space
-	const float RHW = 1.0f / Result.W;
-	Result.X *= RHW;
-	Result.Y *= RHW;
-
-	// Move from projection space to normalized 0..1 UI space
-	/*const float NormX = (Result.X / 2.f) + 0.5f;
-	const float NormY = 1.f - (Result.Y / 2.f) - 0.5f;
-
-	if (NormX < 0.0f || NormX > 1.0f || NormY < 0.0f || NormY > 1.0f)
-	{
-		return false;
-	}*/
-
-	if (Result.X < -1.0f || Result.X > 1.0f || Result.Y < -1.0f || Result.Y > 1.0f)
-	{
-		return false;
-	}
-	return true;
-}
-
 void UTeleportCaptureComponent::startStreaming(avs::uid id,teleport::server::ClientNetworkContext* context)
 {
 	clientId = id;
@@ -372,6 +666,9 @@ void UTeleportCaptureComponent::startStreaming(avs::uid id,teleport::server::Cli
 		}
 	}
 
+	Monitor->EncodeScheduler.AddClient(clientId);
+	Monitor->StreamingCaptureComponents.AddUnique(this);
+
 	EncodePipeline.reset(new FEncodePipelineMonoscopic);
 	EncodePipeline->Initialise(clientId,EncodeParams, context, Monitor);
 
@@ -388,18 +685,32 @@ void UTeleportCaptureComponent::startStreaming(avs::uid id,teleport::server::Cli
 	FQuat UnrealOrientation = GetComponentTransform().GetRotation();
 	ClientCamInfo.orientation = {(float)UnrealOrientation.X, (float)UnrealOrientation.Y, (float)UnrealOrientation.Z, (float)UnrealOrientation.W};
 
-	CreateCubeQuads(CubeQuads, Monitor->BlocksPerCubeFaceAcross, TextureTarget->GetSurfaceWidth());
+	CreateCubeQuads(CubeCorners, Monitor->BlocksPerCubeFaceAcross, TextureTarget->GetSurfaceWidth());
 
-	QuadsToRender.Init(true, CubeQuads.Num());
+	QuadsToRender.Init(true, CubeCorners.NumBlocks);
 	FacesToRender.Init(true, 6);
 }
 
 void UTeleportCaptureComponent::stopStreaming()
 {
+	if (ATeleportMonitor* Monitor = ATeleportMonitor::Instantiate(GetWorld()))
+	{
+		Monitor->EncodeScheduler.RemoveClient(clientId);
+		Monitor->StreamingCaptureComponents.Remove(this);
+		for (const auto& Follower : CaptureFollowers)
+		{
+			if (Follower.IsValid())
+			{
+				Follower->SetCaptureLeader(nullptr, Monitor);
+			}
+		}
+	}
+	CaptureFollowers.Empty();
+	CaptureLeader.Reset();
 	clientId=0;
 	bIsStreaming = false;
 	bCaptureEveryFrame = false;
-	CubeQuads.Empty();
+	CubeCorners = FCubeBlockCorners();
 	QuadsToRender.Empty();
 	FacesToRender.Empty();
 
@@ -430,6 +741,12 @@ void UTeleportCaptureComponent::OnViewportDrawn()
 {
 }
 
+uint64 UTeleportCaptureComponent::GetEncodeDeadlineMisses() const
+{
+	ATeleportMonitor* Monitor = ATeleportMonitor::Instantiate(GetWorld());
+	return Monitor ? Monitor->EncodeScheduler.GetDeadlineMisses(clientId) : 0;
+}
+
 teleport::server::CameraInfo& UTeleportCaptureComponent::getClientCameraInfo()
 {
 	return ClientCamInfo;
@@ -15,6 +15,7 @@
 #include "Engine/TextureRenderTargetCube.h"
 #include <algorithm>
 #include "Pipelines/EncodePipelineInterface.h"
+#include "Pipelines/EncodeTimings.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/DirectionalLight.h"
 #include "Components/DirectionalLightComponent.h"
@@ -22,10 +23,14 @@
 #include "Components/SkyLightComponent.h"
 #include "RHIResources.h"
 #include "Components/ReflectionCaptureCacheFns.h"
+#include "Components/ReflectionLightBuffer.h"
 #include "libavstream/common_maths.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "ShaderParameterStruct.h"
 
-#define GETSAFERHISHADER_COMPUTE(Shader) \
-			Shader.GetComputeShader()
+DECLARE_GPU_STAT_NAMED(TeleportUpdateReflections, TEXT("Teleport Update Reflections"));
+DECLARE_GPU_STAT_NAMED(TeleportWriteReflections, TEXT("Teleport Write Reflections"));
 
 enum class EUpdateReflectionsVariant
 {
@@ -45,168 +50,27 @@ public:
 	FUpdateReflectionsBaseCS(const ShaderMetaType::CompiledShaderInitializerType &Initializer)
 		: FGlobalShader(Initializer)
 	{
-		InputCubeMap.Bind(Initializer.ParameterMap, TEXT("InputCubeMap"));
-	
-		DefaultSampler.Bind(Initializer.ParameterMap, TEXT("DefaultSampler"));
-		RWOutputTexture.Bind(Initializer.ParameterMap, TEXT("OutputTexture"));
-		DirLightCount.Bind(Initializer.ParameterMap, TEXT("DirLightCount"));
-		DirLightStructBuffer.Bind(Initializer.ParameterMap, TEXT("DirLights"));
-		InputCubemapAsArrayTexture.Bind(Initializer.ParameterMap, TEXT("InputCubemapAsArrayTexture"));
-		RWStreamOutputTexture.Bind(Initializer.ParameterMap, TEXT("StreamOutputTexture"));
-		check(RWOutputTexture.IsUAVBound()|| RWStreamOutputTexture.IsUAVBound());
-		Offset.Bind(Initializer.ParameterMap, TEXT("Offset"));
-		SourceSize.Bind(Initializer.ParameterMap, TEXT("SourceSize"));
-		TargetSize.Bind(Initializer.ParameterMap, TEXT("TargetSize"));
-		Roughness.Bind(Initializer.ParameterMap, TEXT("Roughness"));
-		RandomSeed.Bind(Initializer.ParameterMap, TEXT("RandomSeed"));
 	}
 	FUpdateReflectionsBaseCS() = default;
-	void SetInputs(
-		FRHICommandList& RHICmdList,
-		FTextureCubeRHIRef InputCubeMapTextureRef,
-		FShaderResourceViewRHIRef DirLightsShaderResourceViewRef = FShaderResourceViewRHIRef(nullptr, false),
-		int32 InDirLightCount = 0)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-
-		if (InputCubeMapTextureRef)
-		{
-			SetTextureParameter(RHICmdList, ShaderRHI, InputCubeMap, DefaultSampler, TStaticSamplerState<SF_Bilinear>::GetRHI(), InputCubeMapTextureRef);
-			//check(InputCubeMap.IsBound());
-		}
-		SetShaderValue(RHICmdList, ShaderRHI, SourceSize, InputCubeMapTextureRef->GetSize());
-
-		if (DirLightsShaderResourceViewRef)
-		{
-			SetShaderValue(RHICmdList, ShaderRHI, DirLightCount, InDirLightCount);
-			SetSRVParameter(RHICmdList, ShaderRHI, DirLightStructBuffer, DirLightsShaderResourceViewRef);
-		}
-	}
-	void SetInputs(
-		FRHICommandList& RHICmdList,
-		FShaderResourceViewRHIRef InputCubeMapSRVRef,
-		int32 InSourceSize,
-		FShaderResourceViewRHIRef DirLightsShaderResourceViewRef=FShaderResourceViewRHIRef(nullptr,false),
-		int32 InDirLightCount=0)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-
-		if (InputCubeMapSRVRef)
-		{
-			SetSRVParameter(RHICmdList, ShaderRHI, InputCubeMap, InputCubeMapSRVRef);
-			if (!InputCubeMap.IsBound())
-			{
-				check(InputCubeMap.IsBound());
-			}
-		}
-		SetShaderValue(RHICmdList, ShaderRHI, SourceSize, InSourceSize);
 
-		if (DirLightsShaderResourceViewRef)
-		{
-			SetShaderValue(RHICmdList, ShaderRHI, DirLightCount, InDirLightCount);
-			SetSRVParameter(RHICmdList, ShaderRHI, DirLightStructBuffer, DirLightsShaderResourceViewRef);
-		}
-	}
-	 
-	void SetOutputs(
-		FRHICommandList& RHICmdList,
-		FTextureCubeRHIRef OutputColorTextureRef,
-		FUnorderedAccessViewRHIRef OutputColorTextureUAVRef,
-		int32 InTargetSize)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-		//SetTextureParameter(RHICmdList, ShaderRHI, InputCubeMap, DefaultSampler, TStaticSamplerState<SF_Bilinear>::GetRHI(), InputCubeMapTextureRef);
-		RWOutputTexture.SetTexture(RHICmdList, ShaderRHI, OutputColorTextureRef, OutputColorTextureUAVRef);
-		SetShaderValue(RHICmdList, ShaderRHI, TargetSize, InTargetSize);
-	}
-
-
-	void SetParameters(
-		FRHICommandList& RHICmdList,
-		FIntPoint InOffset,
-		float InRoughness,
-		uint32 InRandomSeed)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-		SetShaderValue(RHICmdList, ShaderRHI, Offset, InOffset);
-		SetShaderValue(RHICmdList, ShaderRHI, Roughness, InRoughness);
-		SetShaderValue(RHICmdList, ShaderRHI, RandomSeed, InRandomSeed);
-	}
-
-	void UnsetParameters(FRHICommandList& RHICmdList)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-		RWOutputTexture.UnsetUAV(RHICmdList, ShaderRHI);
-	}
-
-	void SetStreamParameters(
-		FRHICommandList& RHICmdList,
-		FTextureCubeRHIRef InputColorTextureRef,
-		FUnorderedAccessViewRHIRef InputColorTextureUAVRef,
-		FTexture2DRHIRef OutputColorTextureRef,
-		FUnorderedAccessViewRHIRef OutputColorTextureUAVRef,
-		const FIntPoint& InOffset)
-	{
-		FRHIComputeShader *ShaderRHI = RHICmdList.GetBoundComputeShader();
-		RWOutputTexture.SetTexture(RHICmdList, ShaderRHI, InputColorTextureRef, InputColorTextureUAVRef);
-		RWStreamOutputTexture.SetTexture(RHICmdList, ShaderRHI, OutputColorTextureRef, OutputColorTextureUAVRef);
-		SetShaderValue(RHICmdList, ShaderRHI, Offset, InOffset);
-	}
-	/*
-	virtual bool Serialize(FArchive& Ar) override
-	{
-		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
-		Ar << InputCubeMap;
-		Ar << DefaultSampler;
-		Ar << RWOutputTexture;
-		Ar << InputCubemapAsArrayTexture;
-		Ar << RWStreamOutputTexture;
-		Ar << DirLightCount;
-		Ar << DirLightStructBuffer;
-		Ar << Offset;
-		Ar << SourceSize;
-		Ar << TargetSize;
-		Ar << Roughness;
-		Ar << RandomSeed;
-		return bShaderHasOutdatedParameters;
-	}*/
-public:
-
-struct DirectionalLight 
-{
-	vec4 Color;
-	vec3 Direction;
-};
 DECLARE_INLINE_TYPE_LAYOUT(FUpdateReflectionsBaseCS, NonVirtual);
-/*	SHADER_USE_PARAMETER_STRUCT(FUpdateReflectionsBaseCS, FGlobalShader);
 
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
-	SHADER_PARAMETER_RDG_TEXTURE_SRV(TextureCube, InputCubeMap)
+	SHADER_PARAMETER_RDG_TEXTURE(TextureCube, InputCubeMap)
 	SHADER_PARAMETER_SAMPLER(SamplerState,DefaultSampler)
-	SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, RWOutputTexture)
-	SHADER_PARAMETER_RDG_TEXTURE_SRV(TextureCubeArray, InputCubemapAsArrayTexture)
-	SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, RWStreamOutputTexture)
-	SHADER_PARAMETER(uint32, DirLightCount)
-	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<DirectionalLight>, DirLightStructBuffer)
-	SHADER_PARAMETER(FVector2f, Offset)
-	SHADER_PARAMETER(FVector2f, SourceSize)
-	SHADER_PARAMETER(FVector2f, TargetSize)
+	SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2DArray<float4>, RWOutputTexture)
+	SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, RWStreamOutputTexture)
+	SHADER_PARAMETER(uint32, LightCount)
+	// The lights are shared by every capture in the scene, and persist between graphs.
+	SHADER_PARAMETER_SRV(StructuredBuffer<Light>, Lights)
+	SHADER_PARAMETER(FVector3f, ProbePositionMetres)
+	SHADER_PARAMETER(FIntPoint, Offset)
+	SHADER_PARAMETER(int32, SourceSize)
+	SHADER_PARAMETER(int32, TargetSize)
 	SHADER_PARAMETER(float, Roughness)
-	SHADER_PARAMETER(int, RandomSeed)
-	END_SHADER_PARAMETER_STRUCT()*/
-
-	LAYOUT_FIELD(FShaderResourceParameter, InputCubeMap);
-	LAYOUT_FIELD(FShaderResourceParameter, DefaultSampler);
-	LAYOUT_FIELD(FRWShaderParameter ,RWOutputTexture);
-	LAYOUT_FIELD(FShaderResourceParameter, InputCubemapAsArrayTexture);
-	LAYOUT_FIELD(FRWShaderParameter, RWStreamOutputTexture);
-	LAYOUT_FIELD(FShaderParameter, DirLightCount);
-	LAYOUT_FIELD(FShaderResourceParameter, DirLightStructBuffer);
-	LAYOUT_FIELD(FShaderParameter, Offset);
-	LAYOUT_FIELD(FShaderParameter, SourceSize);
-	LAYOUT_FIELD(FShaderParameter, TargetSize);
-	LAYOUT_FIELD(FShaderParameter, Roughness);
-	LAYOUT_FIELD(FShaderParameter, RandomSeed);
+	SHADER_PARAMETER(uint32, RandomSeed)
+	SHADER_PARAMETER(float, AccumulationWeight)
+	END_SHADER_PARAMETER_STRUCT()
 };
 
 template<EUpdateReflectionsVariant Variant>
@@ -214,6 +78,9 @@ class FUpdateReflectionsCS : public FUpdateReflectionsBaseCS
 {
 	DECLARE_SHADER_TYPE(FUpdateReflectionsCS, Global);
 public:
+	using FParameters = FUpdateReflectionsBaseCS::FParameters;
+	SHADER_USE_PARAMETER_STRUCT(FUpdateReflectionsCS, FUpdateReflectionsBaseCS);
+
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
 		return Parameters.Platform == EShaderPlatform::SP_PCD3D_SM5;
@@ -225,13 +92,6 @@ public:
 		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZEY"), kThreadGroupSize);
 		OutEnvironment.SetDefine(TEXT("MIP_ROUGH"), (Variant ==EUpdateReflectionsVariant::MipRough));
 	}
-
-	FUpdateReflectionsCS() = default;
-	FUpdateReflectionsCS(const FUpdateReflectionsBaseCS::CompiledShaderInitializerType &Initializer)
-		: FUpdateReflectionsBaseCS(Initializer)
-	{
-	}
-
 };
 
 
@@ -243,6 +103,19 @@ IMPLEMENT_SHADER_TYPE(, FUpdateReflectionsCS<EUpdateReflectionsVariant::Mip>, TE
 IMPLEMENT_SHADER_TYPE(, FUpdateReflectionsCS<EUpdateReflectionsVariant::MipRough>, TEXT("/Plugin/Teleport/Private/UpdateReflections.usf"), TEXT("FromMipCS"), SF_Compute)
 IMPLEMENT_SHADER_TYPE(, FUpdateReflectionsCS<EUpdateReflectionsVariant::WriteToStream>, TEXT("/Plugin/Teleport/Private/UpdateReflections.usf"), TEXT("WriteToStreamCS"), SF_Compute)
 
+// Adds one dispatch of the shader over every face of a cube mip of the given size.
+// bAllowAsyncCompute is false while the passes are being timed.
+template<EUpdateReflectionsVariant Variant>
+static void AddUpdateReflectionsPass(FRDGBuilder& GraphBuilder, bool bAllowAsyncCompute, FRDGEventName&& PassName, FGlobalShaderMap* ShaderMap, FUpdateReflectionsBaseCS::FParameters* Parameters, int32 MipSize)
+{
+	TShaderMapRef<FUpdateReflectionsCS<Variant>> ComputeShader(ShaderMap);
+	const int32 ThreadGroupSize = FUpdateReflectionsBaseCS::kThreadGroupSize;
+	uint32 NumThreadGroupsXY = MipSize > ThreadGroupSize ? MipSize / ThreadGroupSize : 1;
+	// Reflections don't depend on the scene rendering that follows, so where async compute overlaps well it can run alongside.
+	const ERDGPassFlags PassFlags = bAllowAsyncCompute && GSupportsEfficientAsyncCompute ? ERDGPassFlags::AsyncCompute : ERDGPassFlags::Compute;
+	FComputeShaderUtils::AddPass(GraphBuilder, MoveTemp(PassName), PassFlags, ComputeShader, Parameters, FIntVector(NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX));
+}
+
 //IMPLEMENT_SHADER_TYPE(, FUpdateReflectionsPS, TEXT("/Plugin/Teleport/Private/UpdateReflections.usf"), TEXT("UpdateReflectionsPS"), SF_Pixel);
 
 #if WITH_EDITOR
@@ -325,31 +198,15 @@ float UTeleportReflectionCaptureComponent::GetInfluenceBoundingRadius() const
 
 void UTeleportReflectionCaptureComponent::Init(FRHICommandListImmediate& RHICmdList,FCubeTexture &t, int32 size, int32 NumMips)
 {
-	FRHITextureCreateDesc CreateCubeDesc = FRHITextureCreateDesc::CreateCube(TEXT("ReflectionCapture"), size, PF_FloatRGBA);
+	// The views of each mip are created by the render graph that uses them.
+	FRHITextureCreateDesc CreateCubeDesc = FRHITextureCreateDesc::CreateCube(TEXT("ReflectionCapture"), size, PF_FloatRGBA)
+		.SetFlags(ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV);
 	t.TextureCubeRHIRef = GDynamicRHI->RHICreateTexture_RenderThread(RHICmdList, CreateCubeDesc);
-	
-	for (int i = 0; i < NumMips; i++)
-	{
-		t.UnorderedAccessViewRHIRefs[i] = RHICreateUnorderedAccessView(t.TextureCubeRHIRef, i);
-	}
-	for (int i = 0; i < NumMips; i++)
-	{
-		t.TextureCubeMipRHIRefs[i] = RHICreateShaderResourceView(t.TextureCubeRHIRef, i);
-	}
 }
 
 void UTeleportReflectionCaptureComponent::Release(FCubeTexture &t)
 {
-	const uint32_t NumMips = t.TextureCubeRHIRef->GetNumMips();
-	for (uint32_t i = 0; i < NumMips; i++)
-	{
-		if (t.UnorderedAccessViewRHIRefs[i])
-			t.UnorderedAccessViewRHIRefs[i]->Release();
-		if (t.TextureCubeMipRHIRefs[i])
-			t.TextureCubeMipRHIRefs[i]->Release();
-	}
-	if (t.TextureCubeRHIRef)
-		t.TextureCubeRHIRef->Release();
+	t.TextureCubeRHIRef.SafeRelease();
 }
 
 void UTeleportReflectionCaptureComponent::Initialize_RenderThread(FRHICommandListImmediate& RHICmdList)
@@ -358,6 +215,8 @@ void UTeleportReflectionCaptureComponent::Initialize_RenderThread(FRHICommandLis
 	Init(RHICmdList, RoughSpecularCubeTexture, specularSize, 3);
 	Init(RHICmdList,DiffuseCubeTexture,diffuseSize, 1);
 	Init(RHICmdList,LightingCubeTexture,lightSize, 1);
+	// The new cubes are empty, so fill them all at once rather than one per frame.
+	bNeedsFullUpdate = true;
 }
 
 void UTeleportReflectionCaptureComponent::Release_RenderThread(FRHICommandListImmediate& RHICmdList)
@@ -378,7 +237,7 @@ static float RoughnessFromMip(float mip, float numMips)
 void UTeleportReflectionCaptureComponent::UpdateReflections_RenderThread(
 	FRHICommandListImmediate& RHICmdList, FScene *Scene,
 	UTextureRenderTargetCube *InSourceTexture,
-	ERHIFeatureLevel::Type FeatureLevel)
+	ERHIFeatureLevel::Type FeatureLevel, FVector SourceLocation, bool bSourceChanged, bool bAmortise, uint32 NumAccumulationPasses, FEncodeTimings* Timings)
 {
 	if (!SpecularCubeTexture.TextureCubeRHIRef || !DiffuseCubeTexture.TextureCubeRHIRef || !LightingCubeTexture.TextureCubeRHIRef)
 		Initialize_RenderThread(RHICmdList);
@@ -407,236 +266,234 @@ void UTeleportReflectionCaptureComponent::UpdateReflections_RenderThread(
 				TargetResource=rt->GetRHI();
 		}
 	}
-	randomSeed++;
-/*	if (Scene->ReflectionSceneData.CubemapArray.IsValid() &&
-		Scene->ReflectionSceneData.CubemapArray.GetRenderTarget().IsValid())
+	const FReflectionLightBuffer& LightBuffer = FReflectionLightBuffer::Get(Scene);
+
+	// The lighting cube depends on the lights and, for point and spot lights, on where the capture is.
+	// The others only depend on the source cubemap.
+	if (bSourceChanged)
 	{
-		CubemapArray = Scene->ReflectionSceneData.CubemapArray.GetRenderTarget().ShaderResourceTexture;
+		StagePasses[Specular] = StagePasses[RoughSpecular] = StagePasses[Diffuse] = StagePasses[Lighting] = 0;
 	}
-	else
+	if (LightBuffer.GetVersion() != LightsVersion)
 	{
+		LightsVersion = LightBuffer.GetVersion();
+		StagePasses[Lighting] = 0;
+	}
+	// The stages without random sampling are complete after one pass.
+	const bool bSpecularMips = SpecularCubeTexture.TextureCubeRHIRef->GetNumMips() > 1;
+	auto IsConverged = [&](int32 Stage)
+	{
+		const uint32 RequiredPasses = (Stage == RoughSpecular || (Stage == Specular && bSpecularMips)) ? NumAccumulationPasses : 1;
+		return StagePasses[Stage] >= RequiredPasses;
+	};
+	bool bUpdateStage[NumReflectionStages] = {};
+	bool bAnyStage = false;
+	for (int32 i = 0; i < NumReflectionStages; i++)
+	{
+		const int32 Stage = (NextStage + i) % NumReflectionStages;
+		if (bNeedsFullUpdate || !IsConverged(Stage))
+		{
+			bUpdateStage[Stage] = bAnyStage = true;
+			if (bAmortise && !bNeedsFullUpdate)
+			{
+				NextStage = (Stage + 1) % NumReflectionStages;
+				break;
+			}
+		}
+	}
+	bNeedsFullUpdate = false;
+	// Converged and unchanged: the cubes already in the stream are left as they are.
+	if (!bAnyStage)
+	{
+		if (Timings)
+		{
+			Timings->SkipGPUWork_RenderThread(FEncodeTimings::EGPUWork::UpdateReflections);
+		}
 		return;
-	}*/
-	//DispatchUpdateReflectionsShader<FUpdateReflectionsCS<EUpdateReflectionsVariant::FromOriginal>>(
-	//	RHICmdList, InSourceTexture->TextureReference.TextureReferenceRHI.GetReference()->GetTextureReference(), Target_UAV,FeatureLevel);
-
-	//FSceneRenderTargetItem& DestCube = Scene->ReflectionSceneData.CubemapArray.GetRenderTarget();
-
-
-	SCOPED_DRAW_EVENT(RHICmdList, UpdateReflections);
+	}
 
 	auto* ShaderMap = GetGlobalShaderMap(FeatureLevel);
-
-	FGraphicsPipelineStateInitializer GraphicsPSOInit;
-	GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
-	GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-	GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+	FRHIRenderQuery* BeginQuery = nullptr;
+	FRHIRenderQuery* EndQuery = nullptr;
+	if (Timings)
+	{
+		Timings->BeginGPUWork_RenderThread(FEncodeTimings::EGPUWork::UpdateReflections, BeginQuery, EndQuery);
+	}
+	const bool bAllowAsyncCompute = !BeginQuery;
+
+	FRDGBuilder GraphBuilder(RHICmdList);
+	FEncodeTimings::AddTimestampPass(GraphBuilder, BeginQuery);
+	RDG_EVENT_SCOPE(GraphBuilder, "UpdateReflections");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, TeleportUpdateReflections);
+	FRDGTextureRef SourceCube = RegisterExternalTexture(GraphBuilder, SourceCubeResource->GetTextureRHI(), TEXT("TeleportReflectionSource"));
+	FRDGTextureRef SpecularCube = RegisterExternalTexture(GraphBuilder, SpecularCubeTexture.TextureCubeRHIRef, TEXT("TeleportSpecularCube"));
+	FRDGTextureRef RoughSpecularCube = RegisterExternalTexture(GraphBuilder, RoughSpecularCubeTexture.TextureCubeRHIRef, TEXT("TeleportRoughSpecularCube"));
+	FRDGTextureRef DiffuseCube = RegisterExternalTexture(GraphBuilder, DiffuseCubeTexture.TextureCubeRHIRef, TEXT("TeleportDiffuseCube"));
+	FRDGTextureRef LightingCube = RegisterExternalTexture(GraphBuilder, LightingCubeTexture.TextureCubeRHIRef, TEXT("TeleportLightingCube"));
+
+	// PassIndex is the number of passes the stage has accumulated since it was reset.
+	auto AllocParameters = [&](FRDGTextureRef TargetCube, int32 MipIndex, int32 MipSize, float roughness, uint32 PassIndex)
+	{
+		FUpdateReflectionsBaseCS::FParameters* Parameters = GraphBuilder.AllocParameters<FUpdateReflectionsBaseCS::FParameters>();
+		Parameters->InputCubeMap = SourceCube;
+		Parameters->DefaultSampler = TStaticSamplerState<SF_Bilinear>::GetRHI();
+		Parameters->RWOutputTexture = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(TargetCube, MipIndex));
+		Parameters->SourceSize = SourceSize;
+		Parameters->TargetSize = MipSize;
+		Parameters->Offset = Offset0;
+		Parameters->Roughness = roughness;
+		Parameters->RandomSeed = PassIndex;
+		Parameters->AccumulationWeight = 1.0f / float(PassIndex + 1);
+		return Parameters;
+	};
 
 	// Specular Reflections
+	if (bUpdateStage[Specular])
 	{
-		typedef FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateSpecular> ShaderType;
-
-		TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateSpecular>> CopyCubemapShader(ShaderMap);
-		TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::Mip>> MipShader(ShaderMap);
-		TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::MipRough>> MipRoughShader(ShaderMap);
-		FUpdateReflectionsBaseCS *s = MipShader.GetShader();
-		FUpdateReflectionsBaseCS *r=MipRoughShader.GetShader();
-		FRHIComputeShader *rhiShaderS = MipShader.GetComputeShader();
-		FRHIComputeShader *rhiShaderR = MipRoughShader.GetComputeShader();
+		const uint32 Seed = StagePasses[Specular];
 		// The 0 mip is copied directly from the source cubemap,
-		{
-			const int32 MipSize = specularSize;
-			CopyCubemapShader->SetInputs(RHICmdList,SourceCubeResource->GetTextureRHI());
-			CopyCubemapShader->SetOutputs(RHICmdList,
-				SpecularCubeTexture.TextureCubeRHIRef,
-				SpecularCubeTexture.UnorderedAccessViewRHIRefs[0],MipSize
-				);
-			CopyCubemapShader->SetParameters(RHICmdList, Offset0, 0.f, randomSeed);
-			
-			SetComputePipelineState(RHICmdList, CopyCubemapShader.GetComputeShader());
-			uint32 NumThreadGroupsXY = (specularSize +1) / ShaderType::kThreadGroupSize;
-			DispatchComputeShader(RHICmdList, CopyCubemapShader.GetShader(), NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-			CopyCubemapShader->UnsetParameters(RHICmdList);
-		}
+		AddUpdateReflectionsPass<EUpdateReflectionsVariant::UpdateSpecular>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("Specular"), ShaderMap
+			, AllocParameters(SpecularCube, 0, specularSize, 0.f, Seed), specularSize);
 		// The other mips are generated
 		int32 MipSize = specularSize;
-		int32 PrevMipSize = specularSize;
 		uint32_t NumMips = SpecularCubeTexture.TextureCubeRHIRef->GetNumMips();
 		for (uint32 MipIndex = 1; MipIndex < NumMips; MipIndex++)
 		{
 			float roughness = RoughnessFromMip((float)MipIndex, (float)(2* NumMips));
-			FUpdateReflectionsBaseCS *Shader=static_cast<FUpdateReflectionsBaseCS *>((roughness < 0.99f) ? s:r);
-			FRHIComputeShader *rhiShader=((roughness<0.99f)?rhiShaderS:rhiShaderR);
-			PrevMipSize = MipSize;
 			MipSize = (MipSize + 1) / 2;
 			// Apparently Unreal can't cope with copying from one mip to another in the same texture. So we use the original cube:
-			Shader->SetInputs(RHICmdList,
-				SourceCubeResource->GetTextureRHI());
-			Shader->SetOutputs(RHICmdList,
-				SpecularCubeTexture.TextureCubeRHIRef,
-				SpecularCubeTexture.UnorderedAccessViewRHIRefs[MipIndex],MipSize
-			);
-			Shader->SetParameters(RHICmdList, Offset0, roughness, randomSeed);
-			SetComputePipelineState(RHICmdList, rhiShader);
-			uint32 NumThreadGroupsXY = MipSize > ShaderType::kThreadGroupSize ? MipSize / ShaderType::kThreadGroupSize : 1;
-			DispatchComputeShader(RHICmdList, Shader, NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-			Shader->UnsetParameters(RHICmdList);
+			FUpdateReflectionsBaseCS::FParameters* Parameters = AllocParameters(SpecularCube, MipIndex, MipSize, roughness, Seed);
+			if (roughness < 0.99f)
+				AddUpdateReflectionsPass<EUpdateReflectionsVariant::Mip>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("SpecularMip%d", MipIndex), ShaderMap, Parameters, MipSize);
+			else
+				AddUpdateReflectionsPass<EUpdateReflectionsVariant::MipRough>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("SpecularMip%d", MipIndex), ShaderMap, Parameters, MipSize);
 		}
-		MipSize = specularSize;
-		PrevMipSize = specularSize;
+		if (TargetResource)
+		{
+			FRDGTextureRef TargetCube = RegisterExternalTexture(GraphBuilder, TargetResource, TEXT("TeleportReflectionTarget"));
+			for (uint32 MipIndex = 0; MipIndex < std::min(NumMips, (uint32)TargetResource->GetNumMips()); MipIndex++)
+			{
+				for (int32 CubeFace = 0; CubeFace < CubeFace_MAX; CubeFace++)
+				{
+					FRHICopyTextureInfo CopyTextureInfo;
+					CopyTextureInfo.SourceSliceIndex = CubeFace;
+					CopyTextureInfo.DestSliceIndex =CubeFace+( CaptureIndex >= 0 ? CaptureIndex : 0);
+					CopyTextureInfo.SourceMipIndex =CopyTextureInfo.DestMipIndex= MipIndex;
+					AddCopyTexturePass(GraphBuilder, SpecularCube, TargetCube, CopyTextureInfo);
+				}
+			}
+		}
+	}
+	if (bUpdateStage[RoughSpecular])
+	{
+		const uint32 Seed = StagePasses[RoughSpecular];
+		uint32_t NumMips = SpecularCubeTexture.TextureCubeRHIRef->GetNumMips();
+		int32 MipSize = specularSize;
 		for (uint32 MipIndex = 0; MipIndex < RoughSpecularCubeTexture.TextureCubeRHIRef->GetNumMips(); MipIndex++)
 		{
 			float roughness = RoughnessFromMip(float(NumMips+MipIndex), (float)(2 * NumMips));
-			FUpdateReflectionsBaseCS *Shader = static_cast<FUpdateReflectionsBaseCS *>((roughness < 0.99f) ? s : r);
-			FRHIComputeShader *rhiShader = ((roughness < 0.99f) ? rhiShaderS : rhiShaderR);
-			Shader->SetInputs(RHICmdList,SourceCubeResource->GetTextureRHI());
-			Shader->SetOutputs(RHICmdList,RoughSpecularCubeTexture.TextureCubeRHIRef, RoughSpecularCubeTexture.UnorderedAccessViewRHIRefs[MipIndex], MipSize);
-			Shader->SetParameters(RHICmdList, Offset0, roughness, randomSeed);
-			SetComputePipelineState(RHICmdList, rhiShader);
-			uint32 NumThreadGroupsXY = MipSize > ShaderType::kThreadGroupSize ? MipSize / ShaderType::kThreadGroupSize : 1;
-			DispatchComputeShader(RHICmdList, Shader, NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-			Shader->UnsetParameters(RHICmdList);
-			PrevMipSize = MipSize;
+			FUpdateReflectionsBaseCS::FParameters* Parameters = AllocParameters(RoughSpecularCube, MipIndex, MipSize, roughness, Seed);
+			if (roughness < 0.99f)
+				AddUpdateReflectionsPass<EUpdateReflectionsVariant::Mip>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("RoughSpecularMip%d", MipIndex), ShaderMap, Parameters, MipSize);
+			else
+				AddUpdateReflectionsPass<EUpdateReflectionsVariant::MipRough>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("RoughSpecularMip%d", MipIndex), ShaderMap, Parameters, MipSize);
 			MipSize = (MipSize + 1) / 2;
 		}
 	}
 
 	// Diffuse Reflections
+	if (bUpdateStage[Diffuse])
 	{
-		typedef FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateDiffuse> ShaderType;
-		TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateDiffuse>> ComputeShader(ShaderMap);
-		FUpdateReflectionsBaseCS *Shader = static_cast<FUpdateReflectionsBaseCS *>(ComputeShader.GetShader());
 		uint32_t NumMips = DiffuseCubeTexture.TextureCubeRHIRef->GetNumMips();
 		int32 MipSize = DiffuseCubeTexture.TextureCubeRHIRef->GetSize();
 		for (uint32 MipIndex = 0; MipIndex < NumMips; MipIndex++)
 		{
-			Shader->SetInputs(RHICmdList, SourceCubeResource->GetTextureRHI());
-			Shader->SetOutputs(RHICmdList, DiffuseCubeTexture.TextureCubeRHIRef, DiffuseCubeTexture.UnorderedAccessViewRHIRefs[MipIndex], MipSize);
-			Shader->SetParameters(RHICmdList, Offset0, 1.0, randomSeed);
-			SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(ComputeShader));
-			uint32 NumThreadGroupsXY = MipSize > ShaderType::kThreadGroupSize ? MipSize / ShaderType::kThreadGroupSize : 1;
-			DispatchComputeShader(RHICmdList, Shader, NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-			ComputeShader->UnsetParameters(RHICmdList);
+			AddUpdateReflectionsPass<EUpdateReflectionsVariant::UpdateDiffuse>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("DiffuseMip%d", MipIndex), ShaderMap
+				, AllocParameters(DiffuseCube, MipIndex, MipSize, 1.0f, StagePasses[Diffuse]), MipSize);
 			MipSize = (MipSize + 1) / 2;
 		}
-		if (TargetResource)
-		{
-			for (uint32 MipIndex = 0; MipIndex < std::min(NumMips, (uint32)TargetResource->GetNumMips()); MipIndex++)
-			{
-				for (int32 CubeFace = 0; CubeFace < CubeFace_MAX; CubeFace++)
-				{
-					FRHICopyTextureInfo CopyTextureInfo;
-					CopyTextureInfo.SourceSliceIndex = CubeFace;
-					CopyTextureInfo.DestSliceIndex =CubeFace+( CaptureIndex >= 0 ? CaptureIndex : 0);
-					CopyTextureInfo.SourceMipIndex =CopyTextureInfo.DestMipIndex= MipIndex;
-					RHICmdList.CopyTexture(SpecularCubeTexture.TextureCubeRHIRef
-						, TargetResource,CopyTextureInfo);
-				}
-			}
-		}
 	}
 
 	// Lighting
+	if (bUpdateStage[Lighting] && LightBuffer.GetNumLights())
 	{
-		TResourceArray<FShaderDirectionalLight> ShaderDirLights;
-
-		for (auto& LightInfo : Scene->Lights)
-		{
-			if (LightInfo.LightType == LightType_Directional && LightInfo.LightSceneInfo->bVisible)
-			{
-				// We could update this later to only send dynamic lights if we want
-				FShaderDirectionalLight ShaderDirLight;
-				// The color includes the intensity. Divide by max intensity of 20
-				ShaderDirLight.Color = LightInfo.Color * 0.05f; 
-				ShaderDirLight.Direction = LightInfo.LightSceneInfo->Proxy->GetDirection();
-				ShaderDirLights.Emplace(MoveTemp(ShaderDirLight));
-			}
-		}
-		if (ShaderDirLights.Num())
+		int32 MipSize = lightSize;
+		uint32_t NumMips = LightingCubeTexture.TextureCubeRHIRef->GetNumMips();
+		for (uint32 MipIndex = 0; MipIndex < NumMips; MipIndex++)
 		{
-			FRHIResourceCreateInfo CreateInfo(TEXT("ShaderDirLights"));
-			CreateInfo.ResourceArray = &ShaderDirLights;
-
-			FBufferRHIRef DirLightSB = RHICreateStructuredBuffer(
-				sizeof(FShaderDirectionalLight),
-				ShaderDirLights.Num() * sizeof(FShaderDirectionalLight),
-				BUF_ShaderResource,
-				CreateInfo
-			);
-
-			FShaderResourceViewRHIRef DirLightSRV = RHICreateShaderResourceView(DirLightSB);
-
-			typedef FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateLighting> ShaderType;
-			TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::UpdateLighting>> ComputeShader(ShaderMap);
-			FUpdateReflectionsBaseCS *Shader = static_cast<FUpdateReflectionsBaseCS *>(ComputeShader.GetShader());
-			int32 MipSize = lightSize;
-			uint32_t NumMips = LightingCubeTexture.TextureCubeRHIRef->GetNumMips();
-			for (uint32 MipIndex = 0; MipIndex < NumMips; MipIndex++)
-			{
-				int32 PrevMipSize = MipSize;
-				MipSize = (MipSize + 1) / 2;
-				float roughness = RoughnessFromMip((float)MipIndex, (float)NumMips);
-				Shader->SetInputs(RHICmdList, SourceCubeResource->GetTextureRHI(), DirLightSRV, ShaderDirLights.Num());
-				Shader->SetOutputs(RHICmdList, LightingCubeTexture.TextureCubeRHIRef, LightingCubeTexture.UnorderedAccessViewRHIRefs[MipIndex], MipSize);
-				Shader->SetParameters(RHICmdList, Offset0, 1.0, randomSeed);
-				SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(ComputeShader));
-				uint32 NumThreadGroupsXY = MipSize > ShaderType::kThreadGroupSize ? MipSize / ShaderType::kThreadGroupSize : 1;
-				DispatchComputeShader(RHICmdList, Shader, NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-				ComputeShader->UnsetParameters(RHICmdList);
-			}
-
-			//Release the resources
-			DirLightSRV->Release();
-			DirLightSB->Release();
+			MipSize = (MipSize + 1) / 2;
+			FUpdateReflectionsBaseCS::FParameters* Parameters = AllocParameters(LightingCube, MipIndex, MipSize, 1.0f, StagePasses[Lighting]);
+			Parameters->LightCount = LightBuffer.GetNumLights();
+			Parameters->Lights = LightBuffer.GetSRV();
+			Parameters->ProbePositionMetres = FVector3f(SourceLocation * 0.01);
+			AddUpdateReflectionsPass<EUpdateReflectionsVariant::UpdateLighting>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("LightingMip%d", MipIndex), ShaderMap, Parameters, MipSize);
 		}
 	}
+	for (int32 Stage = 0; Stage < NumReflectionStages; Stage++)
+	{
+		StagePasses[Stage] += bUpdateStage[Stage] ? 1 : 0;
+	}
+	FEncodeTimings::AddTimestampPass(GraphBuilder, EndQuery);
+	GraphBuilder.Execute();
 }
 
 // write the reflections to the UAV of the output video stream.
-void Decompose_RenderThread(FRHICommandListImmediate& RHICmdList
-	, FCubeTexture &CubeTexture, FSurfaceTexture *TargetSurfaceTexture, TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::WriteToStream>> &Shader, FIntPoint TargetOffset)
+static void AddWriteReflectionsPasses(FRDGBuilder& GraphBuilder, bool bAllowAsyncCompute, FGlobalShaderMap* ShaderMap
+	, FRDGTextureRef Cube, FRDGTextureUAVRef SurfaceUAV, FIntPoint TargetOffset)
 {
-	auto *ComputeShader = (FUpdateReflectionsCS<EUpdateReflectionsVariant::WriteToStream> *)Shader.GetComputeShader(); // Shader;
-	const int32 EffectiveTopMipSize = CubeTexture.TextureCubeRHIRef->GetSizeXYZ().X;
-	const int32 NumMips = CubeTexture.TextureCubeRHIRef->GetNumMips();
-	SCOPED_DRAW_EVENT(RHICmdList, WriteReflections);
+	const int32 EffectiveTopMipSize = Cube->Desc.Extent.X;
+	const int32 NumMips = Cube->Desc.NumMips;
 
 	int32 MipSize = EffectiveTopMipSize;
 	// 2 * W for the colour cube two face height 
 	for (int32 MipIndex = 0; MipIndex < NumMips; MipIndex++)
 	{
-		ComputeShader->SetStreamParameters(RHICmdList,
-			CubeTexture.TextureCubeRHIRef,
-			CubeTexture.UnorderedAccessViewRHIRefs[MipIndex],
-			TargetSurfaceTexture->Texture,
-			TargetSurfaceTexture->UAV,
-			TargetOffset);
-		SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(Shader));
-		uint32 NumThreadGroupsXY = MipSize > ComputeShader->kThreadGroupSize ? MipSize / ComputeShader->kThreadGroupSize : 1;
-		DispatchComputeShader(RHICmdList, Shader, NumThreadGroupsXY, NumThreadGroupsXY, CubeFace_MAX);
-		ComputeShader->UnsetParameters(RHICmdList);
+		FUpdateReflectionsBaseCS::FParameters* Parameters = GraphBuilder.AllocParameters<FUpdateReflectionsBaseCS::FParameters>();
+		Parameters->RWOutputTexture = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(Cube, MipIndex));
+		Parameters->RWStreamOutputTexture = SurfaceUAV;
+		Parameters->Offset = TargetOffset;
+		AddUpdateReflectionsPass<EUpdateReflectionsVariant::WriteToStream>(GraphBuilder, bAllowAsyncCompute, RDG_EVENT_NAME("%s Mip%d", Cube->Name, MipIndex), ShaderMap, Parameters, MipSize);
 		TargetOffset.Y += (MipSize * 2);
 		MipSize = (MipSize + 1) / 2;
 	}
 }
 // write the reflections to the UAV of the output video stream.
 void UTeleportReflectionCaptureComponent::WriteReflections_RenderThread(FRHICommandListImmediate& RHICmdList, FScene *Scene, FSurfaceTexture *TargetSurfaceTexture, ERHIFeatureLevel::Type FeatureLevel
-	,FIntPoint StartOffset)
+	,FIntPoint StartOffset, FEncodeTimings* Timings)
 {
-	SCOPED_DRAW_EVENT(RHICmdList, WriteReflections);
-
-	typedef FUpdateReflectionsCS<EUpdateReflectionsVariant::WriteToStream> ShaderType;
-
+	if (!SpecularCubeTexture.TextureCubeRHIRef || !TargetSurfaceTexture->Texture)
+	{
+		if (Timings)
+		{
+			Timings->SkipGPUWork_RenderThread(FEncodeTimings::EGPUWork::WriteReflections);
+		}
+		return;
+	}
 	auto* ShaderMap = GetGlobalShaderMap(FeatureLevel);
+	FRHIRenderQuery* BeginQuery = nullptr;
+	FRHIRenderQuery* EndQuery = nullptr;
+	if (Timings)
+	{
+		Timings->BeginGPUWork_RenderThread(FEncodeTimings::EGPUWork::WriteReflections, BeginQuery, EndQuery);
+	}
+	const bool bAllowAsyncCompute = !BeginQuery;
 
-	TShaderMapRef<FUpdateReflectionsCS<EUpdateReflectionsVariant::WriteToStream>> ComputeShader(ShaderMap);
-	SCOPED_DRAW_EVENT(RHICmdList, WriteReflections);
+	FRDGBuilder GraphBuilder(RHICmdList);
+	FEncodeTimings::AddTimestampPass(GraphBuilder, BeginQuery);
+	RDG_EVENT_SCOPE(GraphBuilder, "WriteReflections");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, TeleportWriteReflections);
+	FRDGTextureRef Surface = RegisterExternalTexture(GraphBuilder, TargetSurfaceTexture->Texture, TEXT("TeleportColorSurface"));
+	// Each cube is written to its own region of the surface, so the passes needn't wait for each other.
+	FRDGTextureUAVRef SurfaceUAV = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(Surface), ERDGUnorderedAccessViewFlags::SkipBarrier);
 
-//	FShader *Shader = ComputeShader.operator*();
-	Decompose_RenderThread(RHICmdList, DiffuseCubeTexture, TargetSurfaceTexture, ComputeShader, StartOffset + diffuseOffset);
-	Decompose_RenderThread(RHICmdList, SpecularCubeTexture, TargetSurfaceTexture, ComputeShader, StartOffset + specularOffset);
-	Decompose_RenderThread(RHICmdList, RoughSpecularCubeTexture, TargetSurfaceTexture, ComputeShader, StartOffset + roughOffset);
-	Decompose_RenderThread(RHICmdList, LightingCubeTexture, TargetSurfaceTexture, ComputeShader, StartOffset + lightOffset);
+	AddWriteReflectionsPasses(GraphBuilder, bAllowAsyncCompute, ShaderMap, RegisterExternalTexture(GraphBuilder, DiffuseCubeTexture.TextureCubeRHIRef, TEXT("TeleportDiffuseCube")), SurfaceUAV, StartOffset + diffuseOffset);
+	AddWriteReflectionsPasses(GraphBuilder, bAllowAsyncCompute, ShaderMap, RegisterExternalTexture(GraphBuilder, SpecularCubeTexture.TextureCubeRHIRef, TEXT("TeleportSpecularCube")), SurfaceUAV, StartOffset + specularOffset);
+	AddWriteReflectionsPasses(GraphBuilder, bAllowAsyncCompute, ShaderMap, RegisterExternalTexture(GraphBuilder, RoughSpecularCubeTexture.TextureCubeRHIRef, TEXT("TeleportRoughSpecularCube")), SurfaceUAV, StartOffset + roughOffset);
+	AddWriteReflectionsPasses(GraphBuilder, bAllowAsyncCompute, ShaderMap, RegisterExternalTexture(GraphBuilder, LightingCubeTexture.TextureCubeRHIRef, TEXT("TeleportLightingCube")), SurfaceUAV, StartOffset + lightOffset);
+	// As the decompose passes leave it, for the encoder.
+	GraphBuilder.SetTextureAccessFinal(Surface, ERHIAccess::UAVCompute);
+	FEncodeTimings::AddTimestampPass(GraphBuilder, EndQuery);
+	GraphBuilder.Execute();
 }
 
 void UTeleportReflectionCaptureComponent::Initialise()
@@ -650,24 +507,36 @@ void UTeleportReflectionCaptureComponent::Initialise()
 	);
 }
 
-void UTeleportReflectionCaptureComponent::UpdateContents(FScene *Scene,UTextureRenderTargetCube *InSourceTexture, ERHIFeatureLevel::Type FeatureLevel)
+void UTeleportReflectionCaptureComponent::UpdateContents(FScene *Scene,UTextureRenderTargetCube *InSourceTexture, ERHIFeatureLevel::Type FeatureLevel, const FVector &SourceLocation, FEncodeTimings* Timings)
 {
+	// Other changes in the scene aren't tracked, so the reflections are also refreshed every RefreshFrames.
+	FramesSinceUpdate++;
+	bool bSourceChanged = !bHasUpdated || FVector::DistSquared(SourceLocation, LastUpdateLocation) > FMath::Square(UpdateDistance)
+		|| (RefreshFrames > 0 && FramesSinceUpdate >= RefreshFrames);
+	if (bSourceChanged)
+	{
+		LastUpdateLocation = SourceLocation;
+		FramesSinceUpdate = 0;
+		bHasUpdated = true;
+	}
+	const bool bAmortise = bAmortiseUpdates;
+	const uint32 NumAccumulationPasses = (uint32)FMath::Max(AccumulationPasses, 1);
 	ENQUEUE_RENDER_COMMAND(TeleportCopyReflections)(
-		[this, Scene, InSourceTexture, FeatureLevel](FRHICommandListImmediate& RHICmdList)
+		[this, Scene, InSourceTexture, FeatureLevel, SourceLocation, bSourceChanged, bAmortise, NumAccumulationPasses, Timings](FRHICommandListImmediate& RHICmdList)
 		{
 			//SCOPED_DRAW_EVENT(RHICmdList, TeleportReflectionCaptureComponent);
-			UpdateReflections_RenderThread(RHICmdList, Scene, InSourceTexture, FeatureLevel);
+			UpdateReflections_RenderThread(RHICmdList, Scene, InSourceTexture, FeatureLevel, SourceLocation, bSourceChanged, bAmortise, NumAccumulationPasses, Timings);
 		}
 	);
 }
 
-void UTeleportReflectionCaptureComponent::PrepareFrame(FScene *Scene, FSurfaceTexture *TargetSurfaceTexture, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset)
+void UTeleportReflectionCaptureComponent::PrepareFrame(FScene *Scene, FSurfaceTexture *TargetSurfaceTexture, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset, FEncodeTimings* Timings)
 {
 	ENQUEUE_RENDER_COMMAND(TeleportWriteReflectionsToSurface)(
-		[this, Scene, TargetSurfaceTexture, FeatureLevel, StartOffset](FRHICommandListImmediate& RHICmdList)
+		[this, Scene, TargetSurfaceTexture, FeatureLevel, StartOffset, Timings](FRHICommandListImmediate& RHICmdList)
 		{
 			//SCOPED_DRAW_EVENT(RHICmdList, TeleportReflectionCaptureComponent);
-			WriteReflections_RenderThread(RHICmdList, Scene, TargetSurfaceTexture, FeatureLevel, StartOffset);
+			WriteReflections_RenderThread(RHICmdList, Scene, TargetSurfaceTexture, FeatureLevel, StartOffset, Timings);
 		}
 	);
 }
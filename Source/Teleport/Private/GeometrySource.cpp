@@ -36,8 +36,6 @@
 
 // For ticker to update periodically
 #include "Containers/Ticker.h"
-
-//For progress bar while compressing textures.
 #include "Misc/ScopedSlowTask.h"
  
 #include "TeleportMonitor.h"
@@ -46,8 +44,13 @@
 #include "TeleportServer/PluginMain.h"
 #include "TeleportServer/InteropStructures.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "VertexConversion.h"
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
  
 #include <functional> //std::function
+#include <atomic>
+#include <algorithm>
   
 #if 0 
 #include <random> 
@@ -185,6 +188,84 @@ FString GetResourcePath(T *obj, bool force=false)
 	return path;
 }
 
+// With incremental extraction, even forced extraction skips resources whose content hasn't changed.
+static bool SkipUnchangedResources(bool force)
+{
+	if(!force)
+		return true;
+	const UTeleportSettings *TeleportSettings=GetDefault<UTeleportSettings>();
+	return TeleportSettings&&TeleportSettings->IncrementalExtraction;
+}
+
+//! Hash of everything ConvertMesh reads from the mesh, or zero if the render data isn't ready.
+static uint64 GetMeshContentHash(UStaticMesh *staticMesh,bool reverseUVYAxis)
+{
+	FStaticMeshRenderData *renderData=staticMesh->GetRenderData();
+	if(!renderData||!renderData->IsInitialized()||!renderData->LODResources.Num())
+		return 0;
+	FStaticMeshLODResources &lod=renderData->LODResources[0];
+	const FPositionVertexBuffer &pb=lod.VertexBuffers.PositionVertexBuffer;
+	const FStaticMeshVertexBuffer &vb=lod.VertexBuffers.StaticMeshVertexBuffer;
+	const size_t numVertices=pb.GetNumVertices();
+	uint64 hash=FResourceHashCache::Combine(0,reverseUVYAxis);
+	hash=FResourceHashCache::Combine(hash,pb.GetVertexData(),numVertices*pb.GetStride());
+	if(vb.GetTangentData())
+		hash=FResourceHashCache::Combine(hash,vb.GetTangentData(),numVertices*(vb.GetUseHighPrecisionTangentBasis()?16:8));
+	if(vb.GetTexCoordData())
+		hash=FResourceHashCache::Combine(hash,vb.GetTexCoordData(),numVertices*vb.GetNumTexCoords()*(vb.GetUseFullPrecisionUVs()?8:4));
+	FRawStaticIndexBuffer &ib=lod.IndexBuffer;
+	FIndexArrayView arr=ib.GetArrayView();
+	hash=FResourceHashCache::Combine(hash,reinterpret_cast<const void*>(((uint64*)&arr)[0]),ib.GetNumIndices()*(ib.Is32Bit()?4:2));
+	for(const FStaticMeshSection &section:lod.Sections)
+	{
+		hash=FResourceHashCache::Combine(hash,section.FirstIndex);
+		hash=FResourceHashCache::Combine(hash,section.NumTriangles);
+		hash=FResourceHashCache::Combine(hash,section.MinVertexIndex);
+		hash=FResourceHashCache::Combine(hash,section.MaxVertexIndex);
+	}
+	return hash;
+}
+
+static uint64 CombineTextureAccessor(uint64 hash,const avs::TextureAccessor &t)
+{
+	hash=FResourceHashCache::Combine(hash,t.index);
+	hash=FResourceHashCache::Combine(hash,t.texCoord);
+	hash=FResourceHashCache::Combine(hash,t.tiling);
+	return FResourceHashCache::Combine(hash,t.scale);
+}
+
+//! Hash of the decomposed material: if this hasn't changed, storing it again would change nothing.
+static uint64 GetMaterialContentHash(const InteropMaterial &m)
+{
+	uint64 hash=FResourceHashCache::Combine(0,m.name,m.name?strlen(m.name):0);
+	hash=FResourceHashCache::Combine(hash,m.materialMode);
+	hash=CombineTextureAccessor(hash,m.pbrMetallicRoughness.baseColorTexture);
+	hash=FResourceHashCache::Combine(hash,m.pbrMetallicRoughness.baseColorFactor);
+	hash=CombineTextureAccessor(hash,m.pbrMetallicRoughness.metallicRoughnessTexture);
+	hash=FResourceHashCache::Combine(hash,m.pbrMetallicRoughness.metallicFactor);
+	hash=FResourceHashCache::Combine(hash,m.pbrMetallicRoughness.roughnessMultiplier);
+	hash=FResourceHashCache::Combine(hash,m.pbrMetallicRoughness.roughnessOffset);
+	hash=CombineTextureAccessor(hash,m.normalTexture);
+	hash=CombineTextureAccessor(hash,m.occlusionTexture);
+	hash=CombineTextureAccessor(hash,m.emissiveTexture);
+	hash=FResourceHashCache::Combine(hash,m.emissiveFactor);
+	hash=FResourceHashCache::Combine(hash,m.doubleSided);
+	return FResourceHashCache::Combine(hash,m.lightmapTexCoord);
+}
+
+#if WITH_EDITOR
+//! The source id is regenerated whenever the source data changes, so we needn't read the mips to detect changes.
+static uint64 GetTextureContentHash(UTexture *texture,avs::TextureCompression textureCompression)
+{
+	uint64 hash=FResourceHashCache::Combine(0,texture->Source.GetId());
+	hash=FResourceHashCache::Combine(hash,textureCompression);
+	uint8 srgb=texture->SRGB;
+	hash=FResourceHashCache::Combine(hash,srgb);
+	uint8 compressionSettings=texture->CompressionSettings;
+	return FResourceHashCache::Combine(hash,compressionSettings);
+}
+#endif
+
 #define LOG_MATERIAL_INTERFACE(materialInterface) UE_LOG(LogTeleport, Warning, TEXT("%s"), *("Decomposing <" + materialInterface->GetName() + ">: Error"));
 #define LOG_UNSUPPORTED_MATERIAL_EXPRESSION(materialInterface, name) UE_LOG(LogTeleport, Warning, TEXT("%s"), *("Decomposing <" + materialInterface->GetName() + ">: Unsupported expression with type name <" + name + ">"));
 #define LOG_UNSUPPORTED_MATERIAL_CHAIN_LENGTH(materialInterface, length) UE_LOG(LogTeleport, Warning, TEXT("%s"), *("Decomposing <" + materialInterface->GetName() + ">: Unsupported property chain length of <" + length + ">"));
@@ -230,8 +311,12 @@ bool GeometrySource::Tick(float DeltaTime)
 	if(!IsRunning())
 	{
 		ExtractNextTexture();
-		CompressTextures();
+		PollLightmapReadbacks();
+		// Compression stops whenever this thread stores something, so only start it once the lightmaps are done.
+		if(!texturesToExtract.Num()&&!numPendingLightmapDecodes)
+			CompressTextures();
 	}
+	resourceHashes.Save();
 #endif
 	return true;
 }
@@ -327,21 +412,70 @@ avs::AttributeSemantic IndexToSemantic(int index)
 
 bool GeometrySource::ExtractMesh(Mesh* mesh, uint8 lodIndex)
 {
-	if (mesh->staticMesh->GetClass()->IsChildOf(USkeletalMesh::StaticClass()))
+	ExtractedMesh extractedMesh;
+	PrepareExtractedMesh(*mesh,extractedMesh);
+	bool result=ConvertMesh(*mesh,lodIndex,extractedMesh)&&StoreExtractedMesh(*mesh,extractedMesh);
+	ReleaseExtractedMesh(extractedMesh);
+	return result;
+}
+
+void GeometrySource::PrepareExtractedMesh(const Mesh &mesh,ExtractedMesh &extractedMesh)
+{
+	// Anything that needs the game thread is done here, before conversion.
+	extractedMesh.name=ToStdString(mesh.staticMesh->GetFullName());
+	extractedMesh.path=ToStdString(GetResourcePath(mesh.staticMesh));
+	extractedMesh.timestamp=0;
+#if WITH_EDITOR
+	extractedMesh.timestamp=GetAssetImportTimestamp(mesh.staticMesh->AssetImportData);
+#endif
+	extractedMesh.arena=AcquireArena();
+}
+
+void GeometrySource::ReleaseExtractedMesh(ExtractedMesh &extractedMesh)
+{
+	// Everything that pointed into the arena goes with it.
+	extractedMesh.primitiveArrays.clear();
+	extractedMesh.buffers.clear();
+	extractedMesh.axesData.clear();
+	extractedMesh.uvs=nullptr;
+	if(extractedMesh.arena)
+		ReleaseArena(MoveTemp(extractedMesh.arena));
+}
+
+TUniquePtr<FScratchArena> GeometrySource::AcquireArena()
+{
+	FScopeLock lock(&ArenaCriticalSection);
+	if(freeArenas.Num())
+		return freeArenas.Pop(false);
+	return MakeUnique<FScratchArena>();
+}
+
+// Typical meshes fit well within this. The memory of a larger one is freed once it's done, rather than kept in the pool.
+static constexpr size_t MaxPooledArenaCapacity=64<<20;
+
+void GeometrySource::ReleaseArena(TUniquePtr<FScratchArena> &&arena)
+{
+	arena->Reset(MaxPooledArenaCapacity);
+	FScopeLock lock(&ArenaCriticalSection);
+	// Keep enough for one mesh per worker: anything beyond that is only needed during a large parallel extraction.
+	if(freeArenas.Num()<FTaskGraphInterface::Get().GetNumWorkerThreads()+1)
+		freeArenas.Add(MoveTemp(arena));
+}
+
+bool GeometrySource::ConvertMesh(const Mesh &mesh, uint8 lodIndex,ExtractedMesh &extractedMesh) const
+{
+	if (mesh.staticMesh->GetClass()->IsChildOf(USkeletalMesh::StaticClass()))
 	{
 		return false;
 	}
 
-	UStaticMesh *StaticMesh = Cast<UStaticMesh>(mesh->staticMesh);
+	UStaticMesh *StaticMesh = Cast<UStaticMesh>(mesh.staticMesh);
 	auto &lods = StaticMesh->GetRenderData()->LODResources;
 	if(lods.Num() == 0) return false;
 
-	if(!ExtractMeshData(mesh, lods[lodIndex], avs::AxesStandard::EngineeringStyle))
-		return false;
-	if(!ExtractMeshData(mesh, lods[lodIndex], avs::AxesStandard::GlStyle))
-		return false;
-	
-	return true;
+	// Every axes standard is written from a single read of the LOD's buffers.
+	static const avs::AxesStandard axesStandards[]={avs::AxesStandard::EngineeringStyle,avs::AxesStandard::GlStyle};
+	return ConvertMeshData(mesh, lods[lodIndex], axesStandards, extractedMesh);
 }
 
 avs::uid GenerateNodeUid()
@@ -349,17 +483,27 @@ avs::uid GenerateNodeUid()
 	return Server_GenerateUid();
 };
 
-bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, avs::AxesStandard axesStandard)
+//! Component order used to write Unreal's x,y,z,w into the given axes standard.
+struct AxesSwizzle
 {
+	int x=0,y=1,z=2,w=3;
+};
+
+bool GeometrySource::ConvertMeshData(const Mesh &mesh, FStaticMeshLODResources &lod, TArrayView<const avs::AxesStandard> axesStandards,ExtractedMesh &extractedMesh) const
+{
+	// Called from worker threads, so the counter is shared safely.
 	auto GenerateUid=[]()
 	{
-		static avs::uid next_uid=1;
+		static std::atomic<avs::uid> next_uid=1;
 		return next_uid++;
 	};
-	std::vector<avs::PrimitiveArray> primitiveArrays;
-	std::map<avs::uid,avs::Accessor> accessors;
-	std::map<avs::uid,avs::BufferView> bufferViews;
-	std::map<avs::uid,avs::GeometryBuffer> buffers;
+	if(axesStandards.Num()==0||!extractedMesh.arena)
+		return false;
+	FScratchArena &arena=*extractedMesh.arena;
+	std::vector<avs::PrimitiveArray> &primitiveArrays=extractedMesh.primitiveArrays;
+	std::map<avs::uid,avs::Accessor> &accessors=extractedMesh.accessors;
+	std::map<avs::uid,avs::BufferView> &bufferViews=extractedMesh.bufferViews;
+	std::map<avs::uid,avs::GeometryBuffer> &buffers=extractedMesh.buffers;
 
 	auto AddBuffer = [](std::map<avs::uid,avs::GeometryBuffer> &buffers,avs::uid b_uid, size_t num, size_t stride, void* data)
 	{
@@ -386,11 +530,15 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 
 	FPositionVertexBuffer& pb = lod.VertexBuffers.PositionVertexBuffer;
 	FStaticMeshVertexBuffer& vb = lod.VertexBuffers.StaticMeshVertexBuffer;
+	const size_t numVertices = pb.GetNumVertices();
 
-	avs::uid positions_uid = GenerateUid();
-	avs::uid normals_uid = GenerateUid();
+	// The layout (buffers, views, accessors and primitive arrays) is the same for every axes standard.
+	// Only the data behind the position, normal and tangent buffers differs, so each standard gets its own
+	// copy of those, and shares the texcoord and index buffers.
+	avs::uid positions_uid = extractedMesh.positions_uid = GenerateUid();
+	avs::uid normals_uid = extractedMesh.normals_uid = GenerateUid();
 #ifndef TELEPORT_PACKED_NORMAL_TANGENTS
-	avs::uid tangents_uid = GenerateUid();
+	avs::uid tangents_uid = extractedMesh.tangents_uid = GenerateUid();
 #endif
 	avs::uid texcoords_uid = GenerateUid();
 	avs::uid indices_uid = GenerateUid();
@@ -405,38 +553,40 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	avs::ComponentType componentType;
 	size_t istride;
 
-	//Switch components based on client.
-	int x, y, z, w;
-	switch(axesStandard)
-	{
-		case avs::AxesStandard::GlStyle:
-			z = 0; x = 1; y = 2; w = 3;
-			break;
-		case avs::AxesStandard::EngineeringStyle:
-			y = 0; x = 1; z = 2; w = 3;
-			break;
-		default:
-			UE_LOG(LogTeleport, Error, TEXT("Attempting to extract mesh data from mesh \"%s\" using unsupported axes standard of %d!"), *mesh->staticMesh->GetName(), axesStandard);
-			x = 0; y = 1; z = 2; w = 3;
-			break;
+	// The per-standard outputs.
+	std::vector<ExtractedMesh::AxesData> &outputs=extractedMesh.axesData;
+	std::vector<AxesSwizzle> swizzles(axesStandards.Num());
+	outputs.resize(axesStandards.Num());
+	for(int a=0;a<axesStandards.Num();a++)
+	{
+		ExtractedMesh::AxesData &o=outputs[a];
+		o.axesStandard=axesStandards[a];
+		//Switch components based on client.
+		AxesSwizzle &s=swizzles[a];
+		if(!GetAxesSwizzle(o.axesStandard,s.x,s.y,s.z,s.w))
+		{
+			UE_LOG(LogTeleport, Error, TEXT("Attempting to extract mesh data from mesh \"%s\" using unsupported axes standard of %d!"), *mesh.staticMesh->GetName(), o.axesStandard);
+		}
+		o.positions=arena.Alloc<vec3>(numVertices);
+#ifndef TELEPORT_PACKED_NORMAL_TANGENTS
+		o.normals=arena.Alloc<vec3>(numVertices);
+		o.tangents=arena.Alloc<vec4>(numVertices);
+#else
+		o.tangentNormals=arena.Alloc<tvector4<signed char>>(numVertices * 2);
+#endif
 	}
 	// First create the Buffers:
-	// Position:
+	// Position: each source vertex is read once and written to all the requested standards.
 	{
-		std::vector<vec3>& p = scaledPositionBuffers[positions_uid];
-		p.resize(pb.GetNumVertices());
-		const float* orig = static_cast<const float*>(pb.GetVertexData());
-		for(size_t j = 0; j < pb.GetNumVertices(); j++)
-		{
-			p[j].x = orig[j * 3 + x] * 0.01f;
-			p[j].y = orig[j * 3 + y] * 0.01f;
-			p[j].z = orig[j * 3 + z] * 0.01f;
-		}
+		std::vector<vec3*> positionOutputs;
+		for(ExtractedMesh::AxesData &o:outputs)
+			positionOutputs.push_back(o.positions);
+		ConvertPositions(static_cast<const float*>(pb.GetVertexData()),numVertices,0.01f,axesStandards,positionOutputs.data());
 		size_t stride = pb.GetStride();
-		AddBuffer(buffers,positions_uid, pb.GetNumVertices(), stride, p.data());
+		AddBuffer(buffers,positions_uid, numVertices, stride, outputs[0].positions);
 		size_t position_stride = pb.GetStride();
 		// Offset is zero, because the sections are just lists of indices. 
-		if(!AddBufferView(bufferViews,positions_uid, positions_view_uid, 0, pb.GetNumVertices(), position_stride))
+		if(!AddBufferView(bufferViews,positions_uid, positions_view_uid, 0, numVertices, position_stride))
 		{
 			UE_LOG(LogTeleport,Error,TEXT("BufferView is bigger than buffer!"));
 			return false;
@@ -444,59 +594,31 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	}
 	// It's not clear that draco compression likes packed tangent-normals, so we'll separate them here:
 #ifndef TELEPORT_PACKED_NORMAL_TANGENTS
-	std::vector<vec3>& normals=normalBuffers[normals_uid];
-	std::vector<vec4>& tangents=tangentBuffers[tangents_uid];
-	normals.resize(pb.GetNumVertices());
-	tangents.resize(pb.GetNumVertices());
+	std::vector<vec4*> tangentOutputs;
+	std::vector<vec3*> normalOutputs;
+	for(ExtractedMesh::AxesData &o:outputs)
+	{
+		tangentOutputs.push_back(o.tangents);
+		normalOutputs.push_back(o.normals);
+	}
 	if(vb.GetUseHighPrecisionTangentBasis())
 	{
-		UE_LOG(LogTeleport,Warning,TEXT("High Precision Tangent Basis is untested, but in-use on mesh \"%s\"."),*mesh->staticMesh->GetName());
-
-		const signed short* original=static_cast<signed short*>(vb.GetTangentData());
+		UE_LOG(LogTeleport,Warning,TEXT("High Precision Tangent Basis is untested, but in-use on mesh \"%s\"."),*mesh.staticMesh->GetName());
 		//Create corrected version of the original tangent buffer for the PC client.
-		for(size_t i=0; i<pb.GetNumVertices(); i++)
-		{
-			//Tangents
-			vec4 &t=tangents[i];
-			t.x=float(original[i*8+x])/16383.f;
-			t.y=float(original[i*8+y])/16383.f;
-			t.z=float(original[i*8+z])/16383.f;
-			t.w=float(original[i*8+w])/16383.f;
-
-			//Normals
-			vec3 &n=normals[i];
-			n.x=float(original[i*8+4+x])/16383.f;
-			n.y=float(original[i*8+4+y])/16383.f;
-			n.z=float(original[i*8+4+z])/16383.f;
-		}
+		ConvertTangentBasis(static_cast<const int16*>(vb.GetTangentData()),numVertices,16383.f,axesStandards,tangentOutputs.data(),normalOutputs.data());
 	}
 	else
 	{
 		//It won't actually swizzle/component-shift if the C-array isn't the correct data type.
-		const signed char* original=static_cast<signed char*>(vb.GetTangentData());
-		for(size_t i=0; i<pb.GetNumVertices(); i++)
-		{
-			//Tangents
-			vec4 &t=tangents[i];
-			t.x=float(original[i*8+x])/127.f;
-			t.y=float(original[i*8+y])/127.f;
-			t.z=float(original[i*8+z])/127.f;
-			t.w=float(original[i*8+w])/127.f;
-
-			//Normals
-			vec3 &n=normals[i];
-			n.x=float(original[i*8+4+x])/127.f;
-			n.y=float(original[i*8+4+y])/127.f;
-			n.z=float(original[i*8+4+z])/127.f;
-		}
+		ConvertTangentBasis(static_cast<const int8*>(vb.GetTangentData()),numVertices,127.f,axesStandards,tangentOutputs.data(),normalOutputs.data());
 	}
 
 	size_t normal_stride=sizeof(vec3);
 	size_t tangent_stride=sizeof(vec4);
 	// Normal:
 	{
-		AddBuffer(buffers,normals_uid,vb.GetNumVertices(),normal_stride,normals.data());
-		if(!AddBufferView(bufferViews,normals_uid,normals_view_uid,0,pb.GetNumVertices(),normal_stride))
+		AddBuffer(buffers,normals_uid,vb.GetNumVertices(),normal_stride,outputs[0].normals);
+		if(!AddBufferView(bufferViews,normals_uid,normals_view_uid,0,numVertices,normal_stride))
 		{
 			UE_LOG(LogTeleport,Error,TEXT("BufferView is bigger than buffer!"));
 			return false;
@@ -505,8 +627,8 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 
 	// Tangent:
 	{
-		AddBuffer(buffers,tangents_uid, vb.GetNumVertices(),tangent_stride, tangents.data());
-		if(!AddBufferView(bufferViews,tangents_uid, tangents_view_uid, 0, pb.GetNumVertices(), tangent_stride))
+		AddBuffer(buffers,tangents_uid, vb.GetNumVertices(),tangent_stride, outputs[0].tangents);
+		if(!AddBufferView(bufferViews,tangents_uid, tangents_view_uid, 0, numVertices, tangent_stride))
 		{
 			UE_LOG(LogTeleport,Error,TEXT("BufferView is bigger than buffer!"));
 			return false;
@@ -514,93 +636,61 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	}
 #else
 	{
-		std::vector<tvector4<signed char>>& tangents = tangentNormalBuffers[normals_uid];
-		tangents.resize(pb.GetNumVertices() * 2);
-
-		if(vb.GetUseHighPrecisionTangentBasis())
+		auto ConvertTangentBasis=[&](const auto *original)
 		{
-			UE_LOG(LogTeleport, Warning, TEXT("High Precision Tangent Basis is untested, but in-use on mesh \"%s\"."), *mesh->staticMesh->GetName());
-
-			const signed short* original = static_cast<signed short*>(vb.GetTangentData());
-			//Create corrected version of the original tangent buffer for the PC client.
-			for(size_t i = 0; i < pb.GetNumVertices(); i++)
+			for(size_t i = 0; i < numVertices; i++)
 			{
-				//Tangents
-				tangents[i * 2].x = original[i * 8 + x];
-				tangents[i * 2].y = original[i * 8 + y];
-				tangents[i * 2].z = original[i * 8 + z];
-				tangents[i * 2].w = original[i * 8 + w];
-
-				//Normals
-				tangents[i * 2 + 1].x = original[i * 8 + 4 + x];
-				tangents[i * 2 + 1].y = original[i * 8 + 4 + y];
-				tangents[i * 2 + 1].z = original[i * 8 + 4 + z];
-				tangents[i * 2 + 1].w = original[i * 8 + 4 + w];
+				const auto *src=original+i*8;
+				for(size_t a=0;a<outputs.size();a++)
+				{
+					const AxesSwizzle &s=swizzles[a];
+					//Tangents
+					tvector4<signed char> *tangents=outputs[a].tangentNormals;
+					tangents[i * 2].x = src[s.x];
+					tangents[i * 2].y = src[s.y];
+					tangents[i * 2].z = src[s.z];
+					tangents[i * 2].w = src[s.w];
+
+					//Normals
+					tangents[i * 2 + 1].x = src[4 + s.x];
+					tangents[i * 2 + 1].y = src[4 + s.y];
+					tangents[i * 2 + 1].z = src[4 + s.z];
+					tangents[i * 2 + 1].w = src[4 + s.w];
+				}
 			}
+		};
+		if(vb.GetUseHighPrecisionTangentBasis())
+		{
+			UE_LOG(LogTeleport, Warning, TEXT("High Precision Tangent Basis is untested, but in-use on mesh \"%s\"."), *mesh.staticMesh->GetName());
+			//Create corrected version of the original tangent buffer for the PC client.
+			ConvertTangentBasis(static_cast<const signed short*>(vb.GetTangentData()));
 		}
 		else
 		{
 			//It won't actually swizzle/component-shift if the C-array isn't the correct data type.
-			const signed char* original = static_cast<signed char*>(vb.GetTangentData());
-			//Create corrected version of the original tangent buffer for the PC client.
-			for(size_t i = 0; i < pb.GetNumVertices(); i++)
-			{
-				//Tangents
-				tangents[i * 2].x = original[i * 8 + x];
-				tangents[i * 2].y = original[i * 8 + y];
-				tangents[i * 2].z = original[i * 8 + z];
-				tangents[i * 2].w = original[i * 8 + w];
-
-				//Normals
-				tangents[i * 2 + 1].x = original[i * 8 + 4 + x];
-				tangents[i * 2 + 1].y = original[i * 8 + 4 + y];
-				tangents[i * 2 + 1].z = original[i * 8 + 4 + z];
-				tangents[i * 2 + 1].w = original[i * 8 + 4 + w];
-			}
+			ConvertTangentBasis(static_cast<const signed char*>(vb.GetTangentData()));
 		}
 
 		size_t tangent_stride = sizeof(signed char) * 8;
 		// Normal:
 		{
-			AddBuffer(normals_uid, vb.GetNumVertices(), tangent_stride, tangents.data());
-			AddBufferView(normals_uid, normals_view_uid, 0, pb.GetNumVertices(), tangent_stride);
+			AddBuffer(buffers,normals_uid, vb.GetNumVertices(), tangent_stride, outputs[0].tangentNormals);
+			AddBufferView(bufferViews,normals_uid, normals_view_uid, 0, numVertices, tangent_stride);
 		}
-
-		// Tangent:
-		/*if(vb.GetTangentData())
-		{
-			size_t stride = vb.GetTangentSize() / vb.GetNumVertices();
-			AddBuffer(tangents_uid, vb.GetNumVertices(), stride, tangents.data());
-			AddBufferView(tangents_uid, tangents_view_uid, 0, pb.GetNumVertices(), tangent_stride);
-		}*/
 	}
 	#endif
-	// TexCoords:
+	// TexCoords: these don't depend on the axes standard, so they're shared.
 	std::vector<FVector2f> uvMin(vb.GetNumTexCoords());
 	std::vector<FVector2f> uvMax(vb.GetNumTexCoords());
 	{
-		std::vector<FVector2f>& uvData = processedUVs[texcoords_uid];
-		uvData.reserve(vb.GetNumVertices() * vb.GetNumTexCoords());
+		FVector2f *uvData = extractedMesh.uvs = arena.Alloc<FVector2f>(vb.GetNumVertices() * vb.GetNumTexCoords());
 
 		size_t texcoords_stride = sizeof(FVector2f);
 		for(size_t j = 0; j < vb.GetNumTexCoords(); j++)
 		{
 			//bool IsFP32 = vb.GetUseFullPrecisionUVs(); //Not need vb.GetVertexUV() returns FP32 regardless. 
-			uvMin[j]={100000.f,100000.f};
-			uvMax[j]={-100000.f,-100000.f};
-			for(uint32_t k = 0; k < vb.GetNumVertices(); k++)
-			{
-				FVector2f v2 = vb.GetVertexUV(k, j);
-				// Reverse y texcoord for consistency with Vulkan, GLTF, OpenGL.
-				if(reverseUVYAxis){
-					v2.Y=1.0f-v2.Y;
-				}
-				uvData.push_back(v2);
-				uvMin[j].X=std::min(uvMin[j].X,v2.X);
-				uvMin[j].Y=std::min(uvMin[j].Y,v2.Y);
-				uvMax[j].X=std::max(uvMax[j].X,v2.X);
-				uvMax[j].Y=std::max(uvMax[j].Y,v2.Y);
-			}
+			// Reverse y texcoord for consistency with Vulkan, GLTF, OpenGL.
+			ConvertTexCoords(vb,j,reverseUVYAxis,uvData+j*numVertices,uvMin[j],uvMax[j]);
 			if(uvMin[j].X>1.f||uvMin[j].Y>1.f)
 			{
 				UE_LOG(LogTeleport,Log,TEXT("Min UV %3.3f %3.3f"),uvMin[j].X,uvMin[j].Y);
@@ -610,12 +700,12 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 				UE_LOG(LogTeleport,Log,TEXT("Max UV %3.3f %3.3f"),uvMax[j].X,uvMax[j].Y);
 			}
 		}
-		AddBuffer(buffers,texcoords_uid, vb.GetNumVertices() * vb.GetNumTexCoords(), texcoords_stride, uvData.data());
+		AddBuffer(buffers,texcoords_uid, vb.GetNumVertices() * vb.GetNumTexCoords(), texcoords_stride, uvData);
 		for(size_t j = 0; j < vb.GetNumTexCoords(); j++)
 		{
 			//bool IsFP32 = vb.GetUseFullPrecisionUVs(); //Not need vb.GetVertexUV() returns FP32 regardless. 
 			texcoords_view_uid[j] = GenerateUid();
-			if(!AddBufferView(bufferViews,texcoords_uid, texcoords_view_uid[j], j * pb.GetNumVertices(), pb.GetNumVertices(), texcoords_stride))
+			if(!AddBufferView(bufferViews,texcoords_uid, texcoords_view_uid[j], j * numVertices, numVertices, texcoords_stride))
 			{
 				UE_LOG(LogTeleport,Error,TEXT("BufferView is bigger than buffer!"));
 				return false;
@@ -623,7 +713,7 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 		}
 	}
 
-	//Indices:
+	//Indices: shared between axes standards.
 	{
 		FRawStaticIndexBuffer& ib = lod.IndexBuffer;
 		FIndexArrayView arr = ib.GetArrayView();
@@ -641,18 +731,19 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	// Now create the views:
 	size_t  num_elements = lod.Sections.Num();
 	primitiveArrays.resize(num_elements);
+	const size_t numAttributeTexCoords=vb.GetTexCoordData()?vb.GetNumTexCoords():0;
 	for(size_t i = 0; i < num_elements; i++)
 	{
 		auto& section = lod.Sections[i];
 		auto& pa =primitiveArrays[i];
 #ifndef TELEPORT_PACKED_NORMAL_TANGENTS
 // pos, normal, tangent + n texcoords
-		pa.attributeCount=3+(vb.GetTexCoordData()?vb.GetNumTexCoords():0);
+		pa.attributeCount=3+numAttributeTexCoords;
 #else
 // pos, normal/tangent + n texcoords
-		pa.attributeCount = 2 + (vb.GetTexCoordData() ? vb.GetNumTexCoords() : 0);
+		pa.attributeCount = 2 + numAttributeTexCoords;
 #endif
-		pa.attributes = new avs::Attribute[10+10*pa.attributeCount];
+		pa.attributes = arena.Alloc<avs::Attribute>(pa.attributeCount);
 		size_t idx = 0;
 		size_t section_vertex_count=(section.MaxVertexIndex+1)-section.MinVertexIndex;
 		// Position:
@@ -709,7 +800,7 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 		}
 		#endif
 		// TexCoords:
-		for(size_t j = 0; j < vb.GetNumTexCoords(); j++)
+		for(size_t j = 0; j < numAttributeTexCoords; j++)
 		{
 			avs::Attribute& attr=pa.attributes[idx++];
 			attr.accessor		=GenerateUid();
@@ -745,19 +836,23 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 		pa.primitiveMode = avs::PrimitiveMode::TRIANGLES;
 	}
 
-	std::string name=ToStdString(mesh->staticMesh->GetFullName());
-	std::string path=ToStdString(GetResourcePath(mesh->staticMesh));
+	return true;
+}
+
+bool GeometrySource::StoreExtractedMesh(const Mesh &mesh,ExtractedMesh &extractedMesh)
+{
+	std::vector<avs::PrimitiveArray> &primitiveArrays=extractedMesh.primitiveArrays;
 	uint64_t inverseBindMatricesAccessorID=0;
 	InteropMesh interopMesh;
 	// Note lifetime, InteropMesh name and path are dumb pointers, but only used within the StoreMesh call.
-	interopMesh.name=name.c_str();
+	interopMesh.name=extractedMesh.name.c_str();
 	interopMesh.primitiveArrayCount=primitiveArrays.size();
 	interopMesh.primitiveArrays=primitiveArrays.data();
 
 
 	std::vector<avs::uid> accessorIDs;
 	std::vector<avs::Accessor> accessorList;
-	for(auto a:accessors)
+	for(auto a:extractedMesh.accessors)
 	{
 		accessorList.push_back(a.second);
 		accessorIDs.push_back(a.first);
@@ -769,7 +864,7 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	
 	std::vector<avs::uid> bufferViewIDs;
 	std::vector<avs::BufferView> bufferViewList;
-	for(auto a:bufferViews)
+	for(auto a:extractedMesh.bufferViews)
 	{
 		bufferViewList.push_back(a.second);
 		bufferViewIDs.push_back(a.first);
@@ -782,7 +877,7 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	
 	std::vector<avs::uid> bufferIDs;
 	std::vector<avs::GeometryBuffer> bufferList;
-	for(auto a:buffers)
+	for(auto a:extractedMesh.buffers)
 	{
 		bufferList.push_back(a.second);
 		bufferIDs.push_back(a.first);
@@ -790,24 +885,46 @@ bool GeometrySource::ExtractMeshData(Mesh *mesh, FStaticMeshLODResources &lod, a
 	interopMesh.bufferCount=bufferIDs.size();
 	interopMesh.bufferIDs=bufferIDs.data();
 	interopMesh.buffers=bufferList.data();
-
+	// The entries in bufferList whose data depends on the axes standard.
+	auto FindBuffer=[&](avs::uid u)->avs::GeometryBuffer&
+	{
+		return bufferList[std::lower_bound(bufferIDs.begin(),bufferIDs.end(),u)-bufferIDs.begin()];
+	};
+	avs::GeometryBuffer &positionBuffer=FindBuffer(extractedMesh.positions_uid);
+	avs::GeometryBuffer &normalBuffer=FindBuffer(extractedMesh.normals_uid);
+#ifndef TELEPORT_PACKED_NORMAL_TANGENTS
+	avs::GeometryBuffer &tangentBuffer=FindBuffer(extractedMesh.tangents_uid);
+#endif
 
 	interopMesh.inverseBindMatricesAccessorID=inverseBindMatricesAccessorID;
 	UpdateCachePath();
-	int64_t timestamp=0;
-#if WITH_EDITOR
-	timestamp=GetAssetImportTimestamp(mesh->staticMesh->AssetImportData);
+	bool result=true;
+	for(ExtractedMesh::AxesData &o:extractedMesh.axesData)
+	{
+		positionBuffer.data=reinterpret_cast<uint8_t*>(o.positions);
+#ifndef TELEPORT_PACKED_NORMAL_TANGENTS
+		normalBuffer.data=reinterpret_cast<uint8_t*>(o.normals);
+		tangentBuffer.data=reinterpret_cast<uint8_t*>(o.tangents);
+#else
+		normalBuffer.data=reinterpret_cast<uint8_t*>(o.tangentNormals);
 #endif
-	return Server_StoreMesh(mesh->id, path.c_str(),timestamp,&interopMesh, axesStandard,false);
+		result&=Server_StoreMesh(mesh.id, extractedMesh.path.c_str(),extractedMesh.timestamp,&interopMesh, o.axesStandard,false);
+	}
+	if(result)
+		resourceHashes.SetHash(GetResourcePath(mesh.staticMesh),mesh.contentHash,mesh.id);
+	return result;
 }
 
 void GeometrySource::UpdateCachePath()
 {
+	// The server isn't thread-safe, so any texture compression stops before this thread uses it. Tick starts it again.
+	textureCompressionQueue.Stop();
 	const UTeleportSettings *TeleportSettings=GetDefault<UTeleportSettings>();
 	if(TeleportSettings)
 	{
 		FString cachePath=TeleportSettings->CachePath.Path;
 		Server_SetCachePath(ToStdString(cachePath).c_str());
+		resourceHashes.SetCachePath(cachePath);
 	}
 }
 avs::uid GeometrySource::AddEmptyNode(UStreamableNode *streamableNode,avs::uid oldID)
@@ -867,18 +984,31 @@ avs::uid GeometrySource::AddEmptyNode(UStreamableNode *streamableNode,avs::uid o
 	return nodeID;
 }
 
-void GeometrySource::UpdateNode(UStreamableNode *streamableNode)
+void GeometrySource::TrackNodeTransform(UStreamableNode *streamableNode)
+{
+	nodeTransformSync.Track(streamableNode);
+}
+
+void GeometrySource::UntrackNodeTransform(UStreamableNode *streamableNode)
 {
-	if(streamableNode->GetUid().Value)
+	nodeTransformSync.Untrack(streamableNode);
+}
+
+void GeometrySource::SendNodeTransforms()
+{
+	if(!Monitor)
 	{
-		USceneComponent *sceneComponent=streamableNode->GetSceneComponent();
-		AActor *Actor=sceneComponent->GetOwner();
-		auto tr=GetComponentTransform(sceneComponent);
-		Server_UpdateNodeTransform(streamableNode->GetUid().Value,tr);
+		nodeTransformSync.Flush(0.0f, 0.0f, 0);
+		return;
 	}
+	// The thresholds are in metres and radians, like the transforms sent.
+	nodeTransformSync.Flush(Monitor->MovementPositionThreshold * 0.01f
+		, FMath::DegreesToRadians(Monitor->MovementRotationThreshold)
+		, Monitor->MaxMovementUpdatesPerFrame);
 }
 avs::uid GeometrySource::AddMeshNode(UStreamableNode *streamableNode, avs::uid oldID)
 {
+	textureCompressionQueue.Stop();
 	avs::uid nodeID=AddEmptyNode(streamableNode,oldID);
 	if(!nodeID)
 		return 0;
@@ -1006,27 +1136,40 @@ avs::Transform GeometrySource::GetComponentTransform(USceneComponent* component)
 
 void GeometrySource::ClearData()
 {
-	scaledPositionBuffers.clear();
-	processedUVs.clear();
-
+	{
+		FScopeLock lock(&ArenaCriticalSection);
+		freeArenas.Empty();
+	}
 	processedNodes.clear();
 	sceneComponentFromNode.clear();
+	nodeTransformSync.Reset();
 	processedMeshes.Empty();
 	processedMaterials.Empty();
 	processedTextures.Empty();
 	processedShadowMaps.Empty();
+	resourceHashes.Clear();
 
+	// The compression task reads from the store we're about to clear.
+	textureCompressionQueue.Stop();
 	Server_ClearGeometryStore();
 }
 
-avs::uid GeometrySource::AddMesh(UMeshComponent *MeshComponent,bool force)
+void GeometrySource::SetPlaying(bool p)
 {
+	playing=p;
+	if(playing)
+		textureCompressionQueue.Stop();
+}
+
+GeometrySource::Mesh *GeometrySource::GetMeshToExtract(UMeshComponent *MeshComponent,bool force,avs::uid &meshID)
+{
+	meshID=0;
 	if(!MeshComponent)
-		return 0;
+		return nullptr;
 	if (MeshComponent->GetClass()->IsChildOf(USkeletalMeshComponent::StaticClass()))
 	{
 		UE_LOG(LogTeleport, Warning, TEXT("Skeletal meshes not supported yet. Found on actor: %s"), *MeshComponent->GetOuter()->GetName());
-		return 0;
+		return nullptr;
 	}
 
 	UStaticMeshComponent* staticMeshComponent = Cast<UStaticMeshComponent>(MeshComponent);
@@ -1035,11 +1178,13 @@ avs::uid GeometrySource::AddMesh(UMeshComponent *MeshComponent,bool force)
 	if(!staticMesh)
 	{
 		UE_LOG(LogTeleport, Warning, TEXT("Actor \"%s\" has been set as streamable, but they have no mesh assigned to their mesh component!"), *MeshComponent->GetOuter()->GetName());
-		return 0;
+		return nullptr;
 	}
 
+	textureCompressionQueue.Stop();
 	//The mesh data was reimported, if the ID string has changed.
 	FString idString=staticMesh->GetFName().ToString();
+	FString resourcePath=GetResourcePath(staticMesh);
 
 	Mesh* mesh;
 
@@ -1049,9 +1194,11 @@ avs::uid GeometrySource::AddMesh(UMeshComponent *MeshComponent,bool force)
 		//Reuse the ID if this mesh has been processed before.
 
 		//Return if we have already processed the mesh in this play session, or the processed data wasn't cleared at the start of the play session, and the mesh data has not changed.
+		//This is checked before hashing, as it's reached for every node that uses the mesh.
 		if(!force&&idString == mesh->bulkDataIDString)
 		{
-			return mesh->id;
+			meshID=mesh->id;
+			return nullptr;
 		}
 	}
 	else
@@ -1059,26 +1206,128 @@ avs::uid GeometrySource::AddMesh(UMeshComponent *MeshComponent,bool force)
 		processedMeshes.Add(staticMesh);
 		//Create a new ID if this mesh has never been processed.
 		mesh=processedMeshes.Find(staticMesh);
-		std::string path = ToStdString(GetResourcePath(staticMesh));
+		std::string path = ToStdString(resourcePath);
 		mesh->id =Server_GetOrGenerateUid(path.c_str());
 	}
 
+	//Only hashed when the mesh is new this session, forced, or reimported.
+	uint64 contentHash=GetMeshContentHash(staticMesh,reverseUVYAxis);
 	mesh->staticMesh = staticMesh;
 	mesh->bulkDataIDString = idString;
+	mesh->contentHash = contentHash;
+	meshID=mesh->id;
+	//Return if the mesh is unchanged since it was stored, in this session or an earlier one, and the store still has it.
+	UpdateCachePath();
+	if(SkipUnchangedResources(force)&&resourceHashes.IsUpToDate(resourcePath,contentHash,mesh->id))
+		return nullptr;
 	PrepareMesh(mesh);
+	return mesh;
+}
+
+avs::uid GeometrySource::AddMesh(UMeshComponent *MeshComponent,bool force)
+{
+	avs::uid meshID=0;
+	Mesh *mesh=GetMeshToExtract(MeshComponent,force,meshID);
+	if(!mesh)
+		return meshID;
 	if(!ExtractMesh(mesh, 0))
 	{
-		UE_LOG(LogTeleport, Error, TEXT("Mesh \"%s\" could not be extracted!"), *staticMesh->GetFullName());
-		auto k = processedMeshes.Find(staticMesh);
-		if(k)
-			processedMeshes.Remove(staticMesh);
+		UE_LOG(LogTeleport, Error, TEXT("Mesh \"%s\" could not be extracted!"), *mesh->staticMesh->GetFullName());
+		processedMeshes.Remove(mesh->staticMesh);
 		return 0;
 	}
 	
 	return mesh->id;
 }
 
+void GeometrySource::ExtractMeshes(TArrayView<UStreamableNode* const> nodes,bool force)
+{
+	// Gather the unique meshes that need extracting. This touches the UObjects and the geometry store, so stays on the game thread.
+	TArray<Mesh> meshes;
+	TSet<UStaticMesh*> uniqueMeshes;
+	for(UStreamableNode *node:nodes)
+	{
+		if(!node)
+			continue;
+		UStaticMeshComponent *staticMeshComponent=Cast<UStaticMeshComponent>(node->GetMesh());
+		// Anything else is reported when the node's resources are extracted.
+		if(!staticMeshComponent||!staticMeshComponent->GetStaticMesh())
+			continue;
+		bool alreadyFound=false;
+		uniqueMeshes.Add(staticMeshComponent->GetStaticMesh(),&alreadyFound);
+		if(alreadyFound)
+			continue;
+		avs::uid meshID=0;
+		Mesh *mesh=GetMeshToExtract(staticMeshComponent,force,meshID);
+		if(mesh)
+			meshes.Add(*mesh);
+	}
+	if(!meshes.Num())
+		return;
+	std::vector<ExtractedMesh> extractedMeshes(meshes.Num());
+	TArray<bool> converted;
+	converted.Init(false,meshes.Num());
+	// The buffer conversion only reads the render data, so it can run on worker threads, ahead of this thread,
+	// which stores each mesh in order as soon as it's ready. A mesh's scratch memory goes back to the pool straight after
+	// its store, and only a limited window of converted meshes is alive at once, so peak memory doesn't grow with the batch.
+	const UTeleportSettings *TeleportSettings=GetDefault<UTeleportSettings>();
+	const bool parallel=!TeleportSettings||TeleportSettings->ParallelMeshExtraction;
+	const int32 window=parallel?2*(FTaskGraphInterface::Get().GetNumWorkerThreads()+1):1;
+	TArray<FGraphEventRef> conversions;
+	conversions.SetNum(meshes.Num());
+	auto LaunchConversion=[&](int32 i)
+	{
+		PrepareExtractedMesh(meshes[i],extractedMeshes[i]);
+		if(!parallel)
+		{
+			converted[i]=ConvertMesh(meshes[i],0,extractedMeshes[i]);
+			return;
+		}
+		conversions[i]=FFunctionGraphTask::CreateAndDispatchWhenReady([this,&meshes,&extractedMeshes,&converted,i]()
+		{
+			converted[i]=ConvertMesh(meshes[i],0,extractedMeshes[i]);
+		},TStatId(),nullptr,ENamedThreads::AnyBackgroundThreadNormalTask);
+	};
+	int32 launched=0;
+	// Submit to the geometry store in order, from this thread only.
+	for(int32 i=0;i<meshes.Num();i++)
+	{
+		while(launched<meshes.Num()&&launched<i+window)
+		{
+			LaunchConversion(launched++);
+		}
+		if(conversions[i].IsValid())
+		{
+			FTaskGraphInterface::Get().WaitUntilTaskCompletes(conversions[i]);
+			conversions[i]=nullptr;
+		}
+		if(!converted[i]||!StoreExtractedMesh(meshes[i],extractedMeshes[i]))
+		{
+			UE_LOG(LogTeleport, Error, TEXT("Mesh \"%s\" could not be extracted!"), *meshes[i].staticMesh->GetFullName());
+			processedMeshes.Remove(meshes[i].staticMesh);
+		}
+		ReleaseExtractedMesh(extractedMeshes[i]);
+	}
+}
+
 bool GeometrySource::ExtractResourcesForNode(UStreamableNode *streamableNode,bool force)
+{
+	return ExtractNodeResources(streamableNode,force,force);
+}
+
+bool GeometrySource::ExtractResourcesForNodes(TArrayView<UStreamableNode* const> nodes,bool force)
+{
+	ExtractMeshes(nodes,force);
+	bool result=true;
+	// The meshes are now up to date, so only the materials may need forcing.
+	for(UStreamableNode *node:nodes)
+	{
+		result&=ExtractNodeResources(node,false,force);
+	}
+	return result;
+}
+
+bool GeometrySource::ExtractNodeResources(UStreamableNode *streamableNode,bool forceMesh,bool forceMaterials)
 {
 	if(!streamableNode)
 		return false;
@@ -1092,7 +1341,7 @@ bool GeometrySource::ExtractResourcesForNode(UStreamableNode *streamableNode,boo
 		UE_LOG(LogTeleport,Error,TEXT("Node \"%s\" has no meshComponent."),*(sceneComponent->GetOwner()->GetName()));
 		return false;
 	}
-	avs::uid dataID=AddMesh(meshComponent,force);
+	avs::uid dataID=AddMesh(meshComponent,forceMesh);
 	if(dataID==0)
 	{
 		UE_LOG(LogTeleport,Error,TEXT("Node \"%s\" failed to add mesh."),*(meshComponent->GetOwner()->GetName()));
@@ -1105,7 +1354,7 @@ bool GeometrySource::ExtractResourcesForNode(UStreamableNode *streamableNode,boo
 	//Add material, and textures, for streaming to clients.
 	for(int32 i=0; i<mats.Num(); i++)
 	{
-		avs::uid materialID=AddMaterial(mats[i],force);
+		avs::uid materialID=AddMaterial(mats[i],forceMaterials);
 		if(materialID!=0)
 			materialIDs.push_back(materialID);
 		else UE_LOG(LogTeleport,Warning,TEXT("Actor \"%s\" has no material applied to material slot %d."),*meshComponent->GetOuter()->GetName(),i);
@@ -1179,6 +1428,7 @@ avs::uid GeometrySource::AddMaterial(UMaterialInterface* materialInterface,bool
 	{
 		std::string path = ToStdString(GetResourcePath(materialInterface));
 		//Create a new ID if this texture has never been processed.
+		textureCompressionQueue.Stop();
 		materialID =Server_GetOrGenerateUid(path.c_str());
 		processedMaterials.Add(materialInterface);
 		m=processedMaterials.Find(materialInterface);
@@ -1186,12 +1436,16 @@ avs::uid GeometrySource::AddMaterial(UMaterialInterface* materialInterface,bool
 	
 	*m= {materialID, true};
 
+	TArray<FString> textureDependencies;
+	materialDependencies=&textureDependencies;
 	InteropMaterial interopMaterial={0};
 	// Defaults for unreal with unconnected sockets:
 	interopMaterial.pbrMetallicRoughness.metallicFactor = 0.0f;
 	interopMaterial.pbrMetallicRoughness.roughnessMultiplier = 0.0f;
 
-	interopMaterial.name = TCHAR_TO_ANSI(*materialInterface->GetName());
+	// Kept alive for the store and the content hash, which both read the name.
+	std::string materialName = ToStdString(materialInterface->GetName());
+	interopMaterial.name = materialName.c_str();
 
 	DecomposeMaterialProperty(materialInterface, EMaterialProperty::MP_BaseColor, interopMaterial.pbrMetallicRoughness.baseColorTexture, interopMaterial.pbrMetallicRoughness.baseColorFactor);
 	DecomposeMaterialProperty(materialInterface, EMaterialProperty::MP_Metallic, interopMaterial.pbrMetallicRoughness.metallicRoughnessTexture, interopMaterial.pbrMetallicRoughness.metallicFactor);
@@ -1243,15 +1497,23 @@ avs::uid GeometrySource::AddMaterial(UMaterialInterface* materialInterface,bool
 	}
 	#endif
 	interopMaterial.lightmapTexCoord=1;
+	materialDependencies=nullptr;
 
-	std::string path = ToStdString(GetResourcePath(materialInterface));
+	FString resourcePath=GetResourcePath(materialInterface);
+	std::string path = ToStdString(resourcePath);
 	int64 timestamp=0;
 #if WITH_EDITOR
 	if (materialInterface->AssetImportData)
 		timestamp = GetAssetImportTimestamp(materialInterface->AssetImportData);
 #endif
 	UpdateCachePath();
-	Server_StoreMaterial(materialID, path.c_str(), timestamp, interopMaterial);
+	//Only store the material if the decomposed properties, or the textures they use, have changed, or the store has lost it.
+	uint64 contentHash=GetMaterialContentHash(interopMaterial);
+	if(!SkipUnchangedResources(force)||!resourceHashes.IsUpToDate(resourcePath,contentHash,materialID))
+	{
+		Server_StoreMaterial(materialID, path.c_str(), timestamp, interopMaterial);
+		resourceHashes.SetHash(resourcePath,contentHash,materialID,textureDependencies);
+	}
 
 	UE_CLOG(interopMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index != interopMaterial.occlusionTexture.index, LogTeleport, Warning, TEXT("Occlusion texture on material <%s> is not combined with metallic-roughness texture."), *materialInterface->GetName());
 
@@ -1269,6 +1531,15 @@ avs::uid GeometrySource::AddShadowMap(const FStaticShadowDepthMapData* shadowDep
 
 void GeometrySource::CompressTextures()
 {
+	if(textureCompressionQueue.IsBusy()||playing)
+		return;
+	UpdateCachePath();
+	textureCompressionQueue.Start();
+}
+
+void GeometrySource::CompressRemainingTextures()
+{
+	textureCompressionQueue.Stop();
 	size_t texturesToCompressCount = Server_GetNumberOfTexturesWaitingForCompression();
 	if(!texturesToCompressCount)
 		return;
@@ -1278,13 +1549,27 @@ void GeometrySource::CompressTextures()
 	FScopedSlowTask compressTextureTask(texturesToCompressCount, FText::Format(LOCTEXT("Compressing Texture", "Starting compression of {0} textures"), texturesToCompressCount));
 	compressTextureTask.MakeDialog(false, true);
 
-	for(int i = 0; i < texturesToCompressCount; i++)
+	for(size_t i = 0; i < texturesToCompressCount; i++)
 	{
+		compressTextureTask.EnterProgressFrame();
 		Server_CompressNextTexture();
 	}
 #undef LOCTEXT_NAMESPACE
 }
 
+void GeometrySource::CancelTextureCompression(bool wait)
+{
+	textureCompressionQueue.Cancel();
+	if(wait)
+		textureCompressionQueue.Wait();
+}
+
+bool GeometrySource::GetTextureCompressionProgress(int32 &compressed,int32 &total) const
+{
+	textureCompressionQueue.GetProgress(compressed,total);
+	return textureCompressionQueue.IsBusy();
+}
+
 void GeometrySource::PrepareMesh(Mesh* mesh)
 {
 	// We will pre-encode the mesh to prepare it for streaming.
@@ -1314,26 +1599,6 @@ void GeometrySource::PrepareMesh(Mesh* mesh)
 	}
 }
 
-void GeometrySource::EnqueueAddProxyTexture_AnyThread(UTexture *source,UTexture *target,FDateTime timestamp,avs::TextureCompression tc)
-{
-	RunLambdaOnGameThread([this,source,target,timestamp,tc]
-		{
-			ProxyAsset pr;
-			pr.modified=timestamp;
-			pr.proxyAsset=target;
-			pr.textureCompression=tc;
-			proxyAssetMap.Add(source,pr);
-			FScopeLock Lock(&ProxiesToStoreCriticalSection);		
-			proxiesToStore.Add(source);
-#if WITH_EDITOR
-			target->PreEditChange(nullptr);
-		// make the package save.
-			CopyTextureToSource((UTexture2D*)target);
-			SaveTexture((UTexture2D*)target);
-#endif
-		});
-}
-
 // Following what UKismetSystemLibrary:: does:
 static FString GetSystemPath(const UObject* Object)
 {
@@ -1399,81 +1664,8 @@ FGraphEventRef GeometrySource::RunLambdaOnGameThread(TFunction<void()> InFunctio
 }
 
 #if WITH_EDITOR
-void GeometrySource::CopyTextureToSource(UTexture2D *Texture)
-{
-	TArray<uint8_t> Array;
-	struct FCopyBufferData {
-		UTexture2D *Texture;
-		TPromise<void> Promise;
-		TArray<uint8_t> DestBuffer;
-	  };
-	using FCommandDataPtr = TSharedPtr<FCopyBufferData, ESPMode::ThreadSafe>;
-	auto Format=Texture->GetPlatformData()->PixelFormat;
-	int texelByteSize=GPixelFormats[Format].BlockBytes;
-	FCommandDataPtr CommandData = MakeShared<FCopyBufferData, ESPMode::ThreadSafe>();
-	CommandData->Texture = Texture;
-	if(!Texture->GetResource())
-	{
-		std::cerr<<"Warning: texture has no resource.\n";
-		return;
-	}
-	if(!Texture->GetResource()->TextureRHI.GetReference())
-	{
-		std::cerr<<"Warning: texture resource has no TextureRHI.\n";
-		return;
-	}
-	FRHITexture2D* Texture2DRHI = Texture->GetResource()->TextureRHI->GetTexture2D();
-	const auto &desc=Texture2DRHI->GetDesc();
-	FIntVector RHIsize=desc.GetSize();
-	if(RHIsize.X!=Texture->GetSizeX()||RHIsize.Y!=Texture->GetSizeY())
-	{
-		std::cerr<<"Warning: texture sizes are different.\n";
-		return;
-	}
-	CommandData->DestBuffer.SetNum(Texture->GetSizeX() * Texture->GetSizeY()*texelByteSize);
-	
-	auto Future = CommandData->Promise.GetFuture();
-	ETextureSourceFormat SourceFormat=(Format==EPixelFormat::PF_FloatRGBA)?ETextureSourceFormat::TSF_RGBA16F:ETextureSourceFormat::TSF_BGRA8;
-	Texture->Source.Init(Texture->GetSizeX(), Texture->GetSizeY(), 1, 1, SourceFormat);
-	ENQUEUE_RENDER_COMMAND(CopyTextureToArray)(
-		[this,Texture,CommandData,texelByteSize](FRHICommandListImmediate& RHICmdList)
-		{
-			uint32 SizeX = CommandData->Texture->GetSizeX();
-			uint32 SizeY = CommandData->Texture->GetSizeY();
-			auto Texture2DRHI = CommandData->Texture->GetResource()->TextureRHI->GetTexture2D();
-			FIntVector mipDims=CommandData->Texture->GetResource()->TextureRHI->GetMipDimensions(0);
-			
-			if(Texture2DRHI->GetSizeX()!=SizeX||Texture2DRHI->GetSizeY()!=SizeY)
-			{
-				std::cerr<<"Warning: texture sizes are different.\n";
-				CommandData->Promise.SetValue();
-				return;
-			}
-			uint32 DestPitch{0};
-			uint8 *MappedTextureMemory = (uint8 *)RHILockTexture2D(Texture2DRHI,0, EResourceLockMode::RLM_ReadOnly, DestPitch,false);
-	
-		  // target size.
-			size_t targetSize=SizeX * SizeY * texelByteSize;
-			// source size:
-			size_t sourceSize=DestPitch*SizeY;
-			if(sourceSize!=targetSize)
-			{
-				std::cerr<<"Warning: source and target texture sizes are different.\n";
-			}
-			size_t dataSize=std::min(sourceSize,targetSize);
-			FMemory::Memcpy(CommandData->DestBuffer.GetData(), MappedTextureMemory,dataSize);
-	
-			RHIUnlockTexture2D(Texture2DRHI, 0, false);
-			// signal completion of the operation
-			CommandData->Promise.SetValue();
-		}
-	);
-
-	// wait until render thread operation completes
-	Future.Get();
-
-	Array = std::move(CommandData->DestBuffer);
-  
+void GeometrySource::SetTextureSourceData(UTexture2D *Texture,const TArray<uint8> &Array)
+{
 	// Now copy into the source.
 	auto *TargetMip=Texture->Source.LockMip(0);
 	FTexturePlatformData *Data=Texture->GetPlatformData();
@@ -1486,28 +1678,129 @@ void GeometrySource::CopyTextureToSource(UTexture2D *Texture)
 	Texture->Source.UnlockMip(0);
 }
 
-void GeometrySource::RenderLightmap_RenderThread(FRHICommandListImmediate &RHICmdList,UTexture* source,UTexture* target,FVector4f LightMapScale,FVector4f LightMapAdd,FDateTime timestamp)
+void GeometrySource::RenderLightmaps_RenderThread(FRHICommandListImmediate &RHICmdList,TArray<LightmapDecode> &&lightmaps)
 {
-	FResolveLightmapComputeShaderDispatchParams Params;
-	Params.TargetTexture=target->GetResource();
-	Params.X=target->GetSurfaceWidth();
-	Params.Y=target->GetSurfaceHeight();
-	Params.SourceTexture=source->GetResource();
-	Params.LightMapScale=LightMapScale;
-	Params.LightMapAdd=LightMapAdd;
-	FRHITexture2D* Texture2DRHI = target->GetResource()->TextureRHI->GetTexture2D();
-	const auto &desc=Texture2DRHI->GetDesc();
-	FIntVector RHIsize=desc.GetSize();
-	int W=((UTexture2D*)target)->GetSizeX();
-	int H=((UTexture2D*)target)->GetSizeY();
-	if(RHIsize.X!=W||RHIsize.Y!=H)
-	{
-		std::cerr<<"Warning: texture sizes are different.\n";
+	TArray<FResolveLightmapComputeShaderDispatchParams> Params;
+	TArray<FRHIGPUTextureReadback*> Readbacks;
+	const int32 firstPending=pendingLightmapDecodes_RenderThread.Num();
+	for(LightmapDecode &l:lightmaps)
+	{
+		FRHITexture2D* Texture2DRHI = l.Target->GetResource()->TextureRHI->GetTexture2D();
+		FIntVector RHIsize=Texture2DRHI->GetDesc().GetSize();
+		if(RHIsize.X!=l.Width||RHIsize.Y!=l.Height)
+		{
+			UE_LOG(LogTeleport,Warning,TEXT("Decoded lightmap for %s is a different size from its source."),*l.Name);
+			numPendingLightmapDecodes--;
+			continue;
+		}
+		FResolveLightmapComputeShaderDispatchParams &P=Params.AddDefaulted_GetRef();
+		P.TargetTexture=l.Target->GetResource();
+		P.X=l.Width;
+		P.Y=l.Height;
+		P.SourceTexture=l.Source->GetResource();
+		P.LightMapScale=l.Scale;
+		P.LightMapAdd=l.Add;
+		// Readbacks are reused, so their staging textures needn't be recreated for every lightmap.
+		if(freeLightmapReadbacks_RenderThread.Num())
+			l.Readback=freeLightmapReadbacks_RenderThread.Pop();
+		else
+			l.Readback=MakeUnique<FRHIGPUTextureReadback>(TEXT("TeleportLightmapReadback"));
+		Readbacks.Add(l.Readback.Get());
+		pendingLightmapDecodes_RenderThread.Add(MoveTemp(l));
+	}
+	if(!Params.Num())
 		return;
+	FResolveLightmapComputeShaderInterface::DispatchRenderThread(RHICmdList,Params,Readbacks);
+	// Those that couldn't be resolved will never be read back, so they're dropped here.
+	for(int32 i=Readbacks.Num()-1;i>=0;i--)
+	{
+		if(Readbacks[i])
+			continue;
+		LightmapDecode &l=pendingLightmapDecodes_RenderThread[firstPending+i];
+		UE_LOG(LogTeleport,Warning,TEXT("Failed to resolve lightmap for %s."),*l.Name);
+		freeLightmapReadbacks_RenderThread.Push(MoveTemp(l.Readback));
+		pendingLightmapDecodes_RenderThread.RemoveAt(firstPending+i);
+		numPendingLightmapDecodes--;
 	}
-	FResolveLightmapComputeShaderInterface::DispatchRenderThread(RHICmdList,Params);
-	EnqueueAddProxyTexture_AnyThread(source,target,timestamp,avs::TextureCompression::KTX);
-	
+}
+
+void GeometrySource::PollLightmapReadbacks()
+{
+	// Lightmaps that were skipped on the render thread may have left a partial batch unsaved.
+	if(!numPendingLightmapDecodes&&decodedLightmapsToSave.Num())
+		SaveDecodedLightmaps();
+	if(!numPendingLightmapDecodes||lightmapPollQueued)
+		return;
+	lightmapPollQueued=true;
+	ENQUEUE_RENDER_COMMAND(TeleportPollLightmapReadbacks)(
+		[this](FRHICommandListImmediate& RHICmdList)
+		{
+			PollLightmapReadbacks_RenderThread();
+			lightmapPollQueued=false;
+		}
+	);
+}
+
+void GeometrySource::PollLightmapReadbacks_RenderThread()
+{
+	for(int i=0;i<pendingLightmapDecodes_RenderThread.Num();)
+	{
+		LightmapDecode &l=pendingLightmapDecodes_RenderThread[i];
+		if(!l.Readback->IsReady())
+		{
+			i++;
+			continue;
+		}
+		// Copy out the rows, without the readback's padding.
+		size_t rowSize=size_t(l.Width)*l.TexelBytes;
+		TArray<uint8> data;
+		data.SetNumUninitialized(rowSize*l.Height);
+		int32 rowPitchInPixels=0;
+		const uint8 *src=static_cast<const uint8*>(l.Readback->Lock(rowPitchInPixels));
+		if(src)
+		{
+			for(int32 y=0;y<l.Height;y++)
+				FMemory::Memcpy(data.GetData()+y*rowSize,src+size_t(y)*rowPitchInPixels*l.TexelBytes,rowSize);
+		}
+		l.Readback->Unlock();
+		freeLightmapReadbacks_RenderThread.Push(MoveTemp(l.Readback));
+		RunLambdaOnGameThread([this,source=l.Source,target=l.Target,timestamp=l.Timestamp,data=MoveTemp(data)]() mutable
+			{
+				AddDecodedLightmap(source,target,timestamp,MoveTemp(data));
+			});
+		pendingLightmapDecodes_RenderThread.RemoveAtSwap(i);
+	}
+}
+
+void GeometrySource::AddDecodedLightmap(UTexture *source,UTexture2D *target,FDateTime timestamp,TArray<uint8> &&data)
+{
+	ProxyAsset pr;
+	pr.modified=timestamp;
+	pr.proxyAsset=target;
+	pr.textureCompression=avs::TextureCompression::KTX;
+	proxyAssetMap.Add(source,pr);
+	{
+		FScopeLock Lock(&ProxiesToStoreCriticalSection);
+		proxiesToStore.Add(source);
+	}
+	target->PreEditChange(nullptr);
+	ETextureSourceFormat SourceFormat=(target->GetPlatformData()->PixelFormat==EPixelFormat::PF_FloatRGBA)?ETextureSourceFormat::TSF_RGBA16F:ETextureSourceFormat::TSF_BGRA8;
+	target->Source.Init(target->GetSizeX(), target->GetSizeY(), 1, 1, SourceFormat);
+	SetTextureSourceData(target,data);
+	decodedLightmapsToSave.Add(target);
+	numPendingLightmapDecodes--;
+	// Save the packages together, once the batch is in, rather than one at a time.
+	const UTeleportSettings *TeleportSettings=GetDefault<UTeleportSettings>();
+	int32 batchSize=TeleportSettings?FMath::Max(TeleportSettings->LightmapBatchSize,1):1;
+	if(!numPendingLightmapDecodes||decodedLightmapsToSave.Num()>=batchSize)
+		SaveDecodedLightmaps();
+}
+
+void GeometrySource::SaveDecodedLightmaps()
+{
+	for(UTexture2D *t:decodedLightmapsToSave)
+		SaveTexture(t);
+	decodedLightmapsToSave.Empty();
 }
 #endif
 
@@ -1532,6 +1825,7 @@ avs::uid GeometrySource::AddLightmapTexture(UTexture* texture,FVector4f Scale,FV
 		// Find out what the path of this lightmap resource should be, then make sure that the Uid corresponds to it.
 		std::string path = ToStdString(GetLightmapResourcePath(texture,WorldPath));
 		//Create a new ID if this texture has never been processed.
+		textureCompressionQueue.Stop();
 		textureID =Server_GetOrGenerateUid(path.c_str());
 		processedTextures.Add(texture->GetFName(),textureID);
 		u=processedTextures.Find(texture->GetFName());
@@ -1558,16 +1852,39 @@ void GeometrySource::ExtractNextTexture()
 {
 	if(!texturesToExtract.Num())
 		return;
-	auto t=texturesToExtract.begin();
-	
+	const UTeleportSettings *TeleportSettings=GetDefault<UTeleportSettings>();
+	int32 batchSize=TeleportSettings?FMath::Max(TeleportSettings->LightmapBatchSize,1):1;
 	FDateTime timestamp=FDateTime::UtcNow();
-	UTexture* texture=t.Value().Texture;
-	FVector4f Scale=t.Value().Scale;
-	FVector4f Add=t.Value().Add;
-	FString WorldPath=t.Value().WorldPath;
-	texturesToExtract.Remove(t->Key);
-		
-	// Send a render command to convert to a usable format:
+	TArray<LightmapDecode> batch;
+	while(texturesToExtract.Num()&&batch.Num()<batchSize)
+	{
+		auto t=texturesToExtract.begin();
+		TextureToExtract T=t.Value();
+		texturesToExtract.Remove(t->Key);
+		LightmapDecode &l=batch.AddDefaulted_GetRef();
+		l.Source=T.Texture;
+		l.Name=T.Texture->GetName();
+		l.Scale=T.Scale;
+		l.Add=T.Add;
+		l.Timestamp=timestamp;
+		l.Target=CreateDecodedLightmap(T.Texture,T.WorldPath);
+		FTexturePlatformData *Data=l.Target->GetPlatformData();
+		l.Width=Data->SizeX;
+		l.Height=Data->SizeY;
+		l.TexelBytes=GPixelFormats[Data->PixelFormat].BlockBytes;
+	}
+	numPendingLightmapDecodes+=batch.Num();
+	// Send a render command to convert the whole batch to a usable format:
+	ENQUEUE_RENDER_COMMAND(TeleportConvertLightmaps)(
+		[this,batch=MoveTemp(batch)](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			RenderLightmaps_RenderThread(RHICmdList,MoveTemp(batch));
+		}
+	);
+}
+
+UTexture2D *GeometrySource::CreateDecodedLightmap(UTexture *texture,const FString &WorldPath)
+{
 	// Requires UnrealEd and AssetRegistry dependencies
 	UTexture2D* DecodedLightmapTexture=nullptr;
 
@@ -1638,20 +1955,21 @@ void GeometrySource::ExtractNextTexture()
 	DecodedLightmapTexture->MarkPackageDirty();
 	FAssetRegistryModule::AssetCreated(DecodedLightmapTexture);
 	DecodedLightmapTexture->PostEditChange();
-	EPixelFormat format=Data->PixelFormat;
-	ENQUEUE_RENDER_COMMAND(TeleportConvertLightmap)(
-		[this,texture,DecodedLightmapTexture,Scale,Add,timestamp](FRHICommandListImmediate& RHICmdList)
-		{
-			RenderLightmap_RenderThread(RHICmdList,texture,DecodedLightmapTexture,Scale,Add,timestamp);
-		}
-	);
 	Package->MarkAsFullyLoaded();
+	return DecodedLightmapTexture;
 }
 #endif
+bool GeometrySource::IsTextureStored(avs::uid u)
+{
+	textureCompressionQueue.Stop();
+	return Server_IsTextureStored(u);
+}
+
 avs::uid GeometrySource::AddTexture(UTexture* texture,bool force)
 {
 	avs::uid textureID;
 	avs::uid *u = processedTextures.Find(texture->GetFName());
+	FString resourcePath=GetResourcePath(texture);
 
 	if(u)
 	{
@@ -1660,8 +1978,9 @@ avs::uid GeometrySource::AddTexture(UTexture* texture,bool force)
 	}
 	else
 	{
-		std::string path = ToStdString(GetResourcePath(texture));
+		std::string path = ToStdString(resourcePath);
 		//Create a new ID if this texture has never been processed.
+		textureCompressionQueue.Stop();
 		textureID =Server_GetOrGenerateUid(path.c_str());
 		processedTextures.Add(texture->GetFName(),textureID);
 		u=processedTextures.Find(texture->GetFName());
@@ -1672,15 +1991,24 @@ avs::uid GeometrySource::AddTexture(UTexture* texture,bool force)
 		UE_LOG(LogTeleport,Warning,TEXT("Wrong Texture group"));
 		return 0;
 	}
+	if(materialDependencies)
+		materialDependencies->Add(resourcePath);
 #if WITH_EDITOR
 	// If we're running/playing, don't try to recompress the texture.
 	if(!IsRunning())
 	{
-		AddTexture_Internal(*u,texture,avs::TextureCompression::BASIS_COMPRESSED);
+		// Nor if the source is unchanged since it was stored.
+		UpdateCachePath();
+		uint64 contentHash=GetTextureContentHash(texture,avs::TextureCompression::BASIS_COMPRESSED);
+		if(!SkipUnchangedResources(force)||!resourceHashes.IsUpToDate(resourcePath,contentHash,*u)||!IsTextureStored(*u))
+		{
+			if(AddTexture_Internal(*u,texture,avs::TextureCompression::BASIS_COMPRESSED))
+				resourceHashes.SetHash(resourcePath,contentHash,*u);
+		}
 	}
 	else
 #endif
-	if(!Server_IsTextureStored(*u))
+	if(!IsTextureStored(*u))
 	{
 		UE_LOG(LogTeleport, Warning, TEXT("Texture %s was not extracted offline, so it cannot be streamed."), *texture->GetName());
 	}
@@ -1688,6 +2016,47 @@ avs::uid GeometrySource::AddTexture(UTexture* texture,bool force)
 }
 
 #if WITH_EDITOR
+//! Copies count bytes of image data from src to dst in one pass, swapping the red and blue bytes of each pixel if swapRedBlue is set.
+//! Returns true if any byte is non-zero.
+static bool CopyImageData(uint8 *dst,const uint8 *src,size_t count,bool swapRedBlue)
+{
+	const VectorRegister4Int greenAlpha=VectorIntSet1(int32(0xFF00FF00));
+	const VectorRegister4Int lowByte=VectorIntSet1(0x000000FF);
+	VectorRegister4Int any=VectorIntSet1(0);
+	size_t i=0;
+	// Four pixels at a time.
+	for(;i+16<=count;i+=16)
+	{
+		VectorRegister4Int v=VectorIntLoad(src+i);
+		any=VectorIntOr(any,v);
+		if(swapRedBlue)
+		{
+			VectorRegister4Int red=VectorIntAnd(VectorShiftRightImmLogical(v,16),lowByte);
+			VectorRegister4Int blue=VectorShiftLeftImmLogical(VectorIntAnd(v,lowByte),16);
+			v=VectorIntOr(VectorIntAnd(v,greenAlpha),VectorIntOr(red,blue));
+		}
+		VectorIntStore(v,dst+i);
+	}
+	alignas(16) uint32 lanes[4];
+	VectorIntStoreAligned(any,lanes);
+	bool nonZero=(lanes[0]|lanes[1]|lanes[2]|lanes[3])!=0;
+	for(size_t j=i;j<count;j++)
+		nonZero|=src[j]!=0;
+	if(swapRedBlue)
+	{
+		for(;i+4<=count;i+=4)
+		{
+			dst[i+0]=src[i+2];
+			dst[i+1]=src[i+1];
+			dst[i+2]=src[i+0];
+			dst[i+3]=src[i+3];
+		}
+	}
+	if(i<count)
+		memcpy(dst+i,src+i,count-i);
+	return nonZero;
+}
+
 bool GeometrySource::AddTexture_Internal(avs::uid textureID,UTexture* texture,avs::TextureCompression textureCompression)
 {
 	InteropTexture interopTexture;
@@ -1746,77 +2115,62 @@ bool GeometrySource::AddTexture_Internal(avs::uid textureID,UTexture* texture,av
 			break;
 	};
 	size_t numMips = textureSource.GetNumMips();
-	bool black=true;
-	struct Image
-	{
-		std::vector<uint8_t> data;
-	};
 	// Images are stored in the order: mip, layer, face, or if face and layer are combined: mip, arrayIndex
-	std::vector<Image> images;
-	images.resize(numMips);
-	size_t totalDataSize=0;
+	// The interop blob is the image count, the offset of each image, then the images. As the image sizes are known
+	// up front, every mip is written straight to its place in the blob.
+	std::vector<uint32_t> imageOffsets(numMips);
+	std::vector<size_t> imageSizes(numMips);
+	std::vector<const uint8*> mipData(numMips);
+	std::vector<size_t> mipDataSizes(numMips);
+	uint32_t offset=sizeof(uint16_t)+numMips*sizeof(uint32_t);
 	for (int m = 0; m < numMips; m++)
 	{
-		FTexture2DMipMap mip = rpd->Mips[m];
-		TArray64<uint8> mipData;
-		textureSource.GetMipData(mipData, 0,0,m);
+		const FTexture2DMipMap &mip = rpd->Mips[m];
+		imageSizes[m] = mip.SizeX * mip.SizeY * mip.SizeZ * bytesPerPixel;
+		imageOffsets[m]=offset;
+		offset+=imageSizes[m];
+		// Locking decompresses the source once for all the mips, and lets us read it without a copy.
+		mipData[m]=textureSource.LockMipReadOnly(0,0,m);
+		mipDataSizes[m]=mipData[m]?textureSource.CalcMipSize(0,0,m):0;
+	}
+	std::vector<uint8_t> imageData(offset);
+	uint8_t *target=(uint8_t *)imageData.data();
+	*((uint16_t *)target)=(uint16_t)numMips;
+	memcpy(target+sizeof(uint16_t),imageOffsets.data(),numMips*sizeof(uint32_t));
 
-		size_t imageDataSize = mip.SizeX * mip.SizeY * mip.SizeZ * bytesPerPixel;
-		images[m].data.resize(imageDataSize);
-		uint8_t *target=images[m].data.data();
-		if(interopTexture.format == avs::TextureFormat::BGRA8)
-		{
-			//Flip red and blue channels from BGR to RGB, eventually we will do this in a compute shader.
-			for (uint32_t i = 0; i <imageDataSize; i += 4)
-			{
-				unsigned char red = mipData[i];
-				target[i+0] = mipData[i+2];
-				target[i+1] = mipData[i+1];
-				target[i+2] = mipData[i+0];
-				target[i+3] = mipData[i+3];
-			}
-		}
-		else
-		{
-			memcpy(target,mipData.GetData(),imageDataSize);
-			float *dataf=(float *)(images[m].data.data());
-			/*for(int i=0;i<mip.SizeX * mip.SizeY;i+=32)
-			{
-				dataf[i*4+0]=1.0f;
-			}*/
-		}
-		uint8_t *data_check=(uint8_t *)(images[m].data.data());
-		for(int i=0;i<mip.SizeX * mip.SizeY*4;i++)
-		{
-			if(data_check[i]!=0)
-				black=false;
-		}
-		target += imageDataSize;
-		totalDataSize+=imageDataSize;
+	// Split the mips into chunks, so that the large top mips are spread across threads too.
+	struct Chunk
+	{
+		int mip;
+		size_t begin,end;
+	};
+	const size_t chunkSize=1<<20;
+	std::vector<Chunk> chunks;
+	for (int m = 0; m < numMips; m++)
+	{
+		for(size_t b=0;b<imageSizes[m];b+=chunkSize)
+			chunks.push_back({m,b,FMath::Min(b+chunkSize,imageSizes[m])});
+	}
+	//Flip red and blue channels from BGR to RGB.
+	const bool swapRedBlue=interopTexture.format == avs::TextureFormat::BGRA8;
+	std::vector<uint8> chunkNonZero(chunks.size(),0);
+	ParallelFor((int32)chunks.size(),[&](int32 i)
+	{
+		const Chunk &c=chunks[i];
+		// Anything beyond the end of the source data is left as zero.
+		size_t end=FMath::Min(c.end,mipDataSizes[c.mip]);
+		if(end>c.begin)
+			chunkNonZero[i]=CopyImageData(target+imageOffsets[c.mip]+c.begin,mipData[c.mip]+c.begin,end-c.begin,swapRedBlue);
+	});
+	for (int m = 0; m < numMips; m++)
+	{
+		if(mipData[m])
+			textureSource.UnlockMip(0,0,m);
 	}
+	bool black=std::find(chunkNonZero.begin(),chunkNonZero.end(),1)==chunkNonZero.end();
 	// All-black texture? not ready yet.
 	if(black)
 		return false;
-	// convert to interop
-	uint32_t offset=sizeof(uint16_t)+images.size()*sizeof(uint32_t);
-	totalDataSize+=offset;
-	std::vector<uint8_t> imageData(totalDataSize);
-	
-	uint8_t *target=(uint8_t *)imageData.data();
-	uint16_t numImages=(uint16_t)images.size();
-	*((uint16_t *)target)=numImages;
-	target += sizeof(uint16_t);
-	uint32_t *offsetTarget=(uint32_t *)target;
-	target+=numImages*sizeof(uint32_t);
-	for(size_t i=0;i<numImages;i++)
-	{
-		const auto &image=images[i];
-		size_t imgSize=image.data.size();
-		memcpy(target,image.data.data(),imgSize);
-		offsetTarget[i]=offset;
-		target+=imgSize;
-		offset+=imgSize;
-	}
 	interopTexture.data=imageData.data();
 	interopTexture.dataSize=imageData.size();
 	FString GameSavedDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir());
@@ -1836,7 +2190,10 @@ bool GeometrySource::AddTexture_Internal(avs::uid textureID,UTexture* texture,av
 	uniqueName=uniqueName.Right(255); //Restrict name length.
 	
 	std::string path = ToStdString(GetResourcePath(texture));
+	textureCompressionQueue.Stop();
 	Server_StoreTexture(textureID,path.c_str(), GetAssetImportTimestamp(texture->AssetImportData), interopTexture, false, useUASTC, false);
+	// New textures to compress, so a cancelled queue can start again.
+	textureCompressionQueue.Resume();
 	return true;
 }
 #endif
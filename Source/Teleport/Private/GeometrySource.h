@@ -2,6 +2,8 @@
 
 #include <map>
 #include <unordered_map>
+#include <string>
+#include <vector>
 
 #include "Windows/AllowWindowsPlatformAtomics.h"
 #include "Windows/PreWindowsApi.h"
@@ -11,6 +13,12 @@
 #include "Platform/CrossPlatform/Shaders/CppSl.sl"
 #include "libavstream/common_maths.h"
 #include "libavstream/material_exports.h"
+#include "ScratchArena.h"
+#include "ResourceHashCache.h"
+#include "TextureCompressionQueue.h"
+#include "RHIGPUReadback.h"
+#include "NodeTransformSync.h"
+#include <atomic>
 
 /*! The Geometry Source keeps all the geometry ready for streaming, and returns geometry
 	data in glTF-style when asked for.
@@ -45,6 +53,8 @@ public:
 	bool Tick(float DeltaTime);
 	void Initialise( ATeleportMonitor* monitor, UWorld* world);
 	void ClearData();
+	//! While playing, the session uses the server every frame, so textures aren't compressed.
+	void SetPlaying(bool playing);
 #if WITH_EDITOR
 	void ExtractNextTexture();
 	#endif
@@ -57,6 +67,10 @@ public:
 
 	/// Extracts the resources for the node, without adding or updating the node itself. Not recursive: call this with recursive nodes to ensure all are considered.
 	bool ExtractResourcesForNode(UStreamableNode *node,bool force);
+	/// As ExtractResourcesForNode, for many nodes at once: the meshes are extracted first with ExtractMeshes.
+	bool ExtractResourcesForNodes(TArrayView<UStreamableNode* const> nodes,bool force);
+	/// Extracts the unique meshes used by the nodes. Buffer conversion runs on worker threads, then the meshes are stored in order on the calling thread.
+	void ExtractMeshes(TArrayView<UStreamableNode* const> nodes,bool force);
 	//Adds the node to the geometry source; decomposing the node to its base components. Will update the node if it has already been processed before.
 	//	component : Scene component the node represents.
 	//	forceUpdate : Causes node data to be extracted, even if it has been before.
@@ -64,8 +78,15 @@ public:
 	avs::uid AddNode(UStreamableNode *node, bool forceUpdate = false);
 	avs::uid GetNodeUid(UStreamableNode *node);
 
-	//! Called from UStreamableRootComponent to update motion.
-	void UpdateNode(UStreamableNode *node);
+	//! Called from UStreamableRootComponent, so the node's transform is sent whenever it moves.
+	void TrackNodeTransform(UStreamableNode *node);
+	void UntrackNodeTransform(UStreamableNode *node);
+	//! Sends the transforms of the tracked nodes that have moved noticeably, within the monitor's per-frame limit. Call once per frame.
+	void SendNodeTransforms();
+
+	//Returns component transform, relative to its parent.
+	//	component : Component we want the transform of.
+	static avs::Transform GetComponentTransform(USceneComponent* component);
 	 
 	USceneComponent *GetNodeSceneComponent(avs::uid u);
 	//Adds the material to the geometry source, where it is processed into a streamable material.
@@ -75,10 +96,16 @@ public:
 	avs::uid AddShadowMap(const FStaticShadowDepthMapData* shadowDepthMapData);
 
 	//Compresses any textures that were found during decomposition of actors.
-	//Split-off so all texture compression can happen at once with a progress bar.
+	//Runs on a background thread, so this returns immediately; use GetTextureCompressionProgress to follow it.
 	void CompressTextures();
+	//! Stops the background task and compresses whatever is still waiting, here and now, showing progress.
+	//! Call before the server starts streaming, so that no texture is left uncompressed for the session.
+	void CompressRemainingTextures();
+	//! Stops compressing after the current texture; the rest stay queued until more textures are extracted.
+	void CancelTextureCompression(bool wait=false);
+	//! Returns true while textures are being compressed.
+	bool GetTextureCompressionProgress(int32 &compressed,int32 &total) const;
 
-	void EnqueueAddProxyTexture_AnyThread(UTexture *source,UTexture *target,FDateTime timestamp,avs::TextureCompression tc);
 	//
 	static FGraphEventRef RunLambdaOnGameThread(TFunction<void()> InFunction);
 	
@@ -96,15 +123,44 @@ protected:
 	FString GetLightmapPackagePath(UTexture *orig_texture,FString WorldPath);
 	FString GetLightmapResourcePath(UTexture *orig_texture,FString WorldPath);
 #if WITH_EDITOR
-	void CopyTextureToSource(UTexture2D *Texture);
+	static void SetTextureSourceData(UTexture2D *Texture,const TArray<uint8> &Data);
 	bool AddTexture_Internal(avs::uid u,UTexture* texture,avs::TextureCompression textureCompression);
-	void RenderLightmap_RenderThread(FRHICommandListImmediate &RHICmdList,UTexture* source,UTexture* target,FVector4f Scale,FVector4f Add,FDateTime timestamp);
+	//! A lightmap being decoded on the GPU, until its data has been read back.
+	struct LightmapDecode
+	{
+		UTexture *Source=nullptr;
+		UTexture2D *Target=nullptr;
+		//! The source's name, taken on the game thread for logging.
+		FString Name;
+		FVector4f Scale;
+		FVector4f Add;
+		FDateTime Timestamp;
+		int32 Width=0;
+		int32 Height=0;
+		int32 TexelBytes=0;
+		TUniquePtr<FRHIGPUTextureReadback> Readback;
+	};
+	//! Game thread: creates or loads the package and texture that the decoded lightmap is written to.
+	UTexture2D *CreateDecodedLightmap(UTexture *texture,const FString &WorldPath);
+	//! Decodes a batch of lightmaps in one render graph, then reads them back asynchronously.
+	void RenderLightmaps_RenderThread(FRHICommandListImmediate &RHICmdList,TArray<LightmapDecode> &&lightmaps);
+	void PollLightmapReadbacks();
+	void PollLightmapReadbacks_RenderThread();
+	//! Game thread: the decoded data has arrived, so the texture can be stored as the lightmap's proxy.
+	void AddDecodedLightmap(UTexture *source,UTexture2D *target,FDateTime timestamp,TArray<uint8> &&data);
+	void SaveDecodedLightmaps();
+	TArray<LightmapDecode> pendingLightmapDecodes_RenderThread;
+	TArray<TUniquePtr<FRHIGPUTextureReadback>> freeLightmapReadbacks_RenderThread;
+	std::atomic<int32> numPendingLightmapDecodes=0;
+	std::atomic<bool> lightmapPollQueued=false;
+	TArray<UTexture2D*> decodedLightmapsToSave;
 #endif
 	struct Mesh
 	{
 		avs::uid id;
 		UStaticMesh *staticMesh;
 		FString bulkDataIDString; // ID string of the bulk data the last time it was processed; changes whenever the mesh data is reimported, so can be used to detect changes.
+		uint64 contentHash; // Hash of the render data the last time it was processed.
 	};
 
 	struct MaterialChangedInfo
@@ -131,12 +187,43 @@ protected:
 
 	 ATeleportMonitor* Monitor=nullptr;
 
-	std::map<avs::uid, std::vector<vec3>> scaledPositionBuffers;
-	std::map<avs::uid, std::vector<tvector4<signed char>>> tangentNormalBuffers; //Stores data to the corrected tangent and normal buffers.
+	FNodeTransformSync nodeTransformSync;
 
-	std::map<avs::uid,std::vector<vec3>> normalBuffers;
-	std::map<avs::uid,std::vector<vec4>> tangentBuffers;
-	std::map<avs::uid, std::vector<FVector2f>> processedUVs;
+	//! Mesh data converted from a LOD's render buffers, waiting to be stored for each axes standard.
+	//! The vertex, texcoord and attribute storage all lives in the arena, which is recycled once Server_StoreMesh has copied it.
+	struct ExtractedMesh
+	{
+		std::string name;
+		std::string path;
+		int64_t timestamp=0;
+		TUniquePtr<FScratchArena> arena;
+		std::vector<avs::PrimitiveArray> primitiveArrays;
+		std::map<avs::uid,avs::Accessor> accessors;
+		std::map<avs::uid,avs::BufferView> bufferViews;
+		std::map<avs::uid,avs::GeometryBuffer> buffers;
+		// The buffers whose data differs per axes standard.
+		avs::uid positions_uid=0;
+		avs::uid normals_uid=0;
+		avs::uid tangents_uid=0;
+		struct AxesData
+		{
+			avs::AxesStandard axesStandard=avs::AxesStandard::NotInitialized;
+			vec3 *positions=nullptr;
+			vec3 *normals=nullptr;
+			vec4 *tangents=nullptr;
+			tvector4<signed char> *tangentNormals=nullptr; //Stores data to the corrected tangent and normal buffers.
+		};
+		std::vector<AxesData> axesData;
+		// Shared by all axes standards.
+		FVector2f *uvs=nullptr;
+	};
+	//! Arenas not currently in use by an ExtractedMesh.
+	TArray<TUniquePtr<FScratchArena>> freeArenas;
+	FCriticalSection ArenaCriticalSection;
+	TUniquePtr<FScratchArena> AcquireArena();
+	void ReleaseArena(TUniquePtr<FScratchArena> &&arena);
+	//! Returns the mesh's arena to the pool once it has been stored, or has failed.
+	void ReleaseExtractedMesh(ExtractedMesh &extractedMesh);
 
 	std::map<avs::uid, USceneComponent *> sceneComponentFromNode;
 	std::map<FName, avs::uid,FNameFastLess> processedNodes; //Nodes we have already stored in the GeometrySource; <Level Unique Node Name, Node Identifier>.
@@ -144,12 +231,28 @@ protected:
 	TMap<UMaterialInterface*, MaterialChangedInfo> processedMaterials; //Materials we have already stored in the GeometrySource; the pointer points to the uid of the stored material information.
 	TMap<FName, avs::uid> processedTextures; //Textures we have already stored in the GeometrySource; the pointer points to the uid of the stored texture information.
 	TMap<const FStaticShadowDepthMapData*, avs::uid> processedShadowMaps;
+	//! Content hashes of the resources as they were stored, persisted in the cache directory.
+	FResourceHashCache resourceHashes;
+	FTextureCompressionQueue textureCompressionQueue;
+	bool playing=false;
+	//! While a material is decomposed, collects the paths of the textures it uses.
+	TArray<FString> *materialDependencies=nullptr;
 #if WITH_EDITOR
 	TMap<FName,TextureToExtract> texturesToExtract;
 #endif
 	void PrepareMesh(Mesh* mesh);
+	//! Returns the mesh if it needs to be extracted, or nullptr if it's up to date or can't be extracted. meshID is zero on failure.
+	Mesh *GetMeshToExtract(class UMeshComponent* MeshComponent,bool force,avs::uid &meshID);
 	bool ExtractMesh(Mesh* mesh, uint8 lodIndex);
-	bool ExtractMeshData(Mesh* mesh, FStaticMeshLODResources& lod, avs::AxesStandard extractToBasis);
+	//! Game thread: fills in the name, path and timestamp.
+	void PrepareExtractedMesh(const Mesh &mesh,ExtractedMesh &extractedMesh);
+	//! Thread-safe: only reads the render data.
+	bool ConvertMesh(const Mesh &mesh, uint8 lodIndex,ExtractedMesh &extractedMesh) const;
+	//! Reads the lod's vertex and index buffers once, and writes the mesh in each of the given axes standards.
+	bool ConvertMeshData(const Mesh &mesh, FStaticMeshLODResources& lod, TArrayView<const avs::AxesStandard> axesStandards,ExtractedMesh &extractedMesh) const;
+	//! Game thread: stores the converted mesh once per axes standard.
+	bool StoreExtractedMesh(const Mesh &mesh,ExtractedMesh &extractedMesh);
+	bool ExtractNodeResources(UStreamableNode *node,bool forceMesh,bool forceMaterials);
 
 	// Add a pure node with no mesh etc.
 	avs::uid AddEmptyNode(UStreamableNode *node,avs::uid oldID);
@@ -163,10 +266,7 @@ protected:
 	//	oldID : ID being used by this node, if zero it will create a new ID.
 	//Returns the ID of the node added.
 	avs::uid AddShadowMapNode(ULightComponent* lightComponent, avs::uid oldID);
-	
-	//Returns component transform.
-	//	component : Component we want the transform of.
-	avs::Transform GetComponentTransform(USceneComponent* component);
+
 
 	//! Equivalent to AddTexture, called only for lightmaps.
 	avs::uid AddLightmapTexture(UTexture* texture,FVector4f Scale,FVector4f Add,FString WorldPath);
@@ -174,6 +274,8 @@ protected:
 	//	texture : UTexture to pull the texture data from.
 	//Returns the uid for this texture.
 	avs::uid AddTexture(UTexture *texture,bool force);
+	//! Server_IsTextureStored, safe to call while textures are being compressed.
+	bool IsTextureStored(avs::uid u);
 
 	//Returns the first texture in the material chain.
 	//	materialInterface : The interface of the material we are decomposing.
@@ -0,0 +1,161 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "GeometryStreamingQueue.h"
+#include "Components/StreamableRootComponent.h"
+#include "Components/StreamableNode.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture.h"
+#include "GameFramework/Actor.h"
+
+// Rough sizes, in bytes, for estimating what an actor costs to send.
+static constexpr int64 BytesPerVertex = 32;
+static constexpr int64 BytesPerTriangle = 12;
+static constexpr int64 BytesPerMaterial = 512;
+static constexpr int64 BytesPerNode = 256;
+// Textures are sent Basis-compressed, which with the mips comes to around a byte per texel of the top mip.
+static constexpr int64 CompressedBytesPerTexel = 1;
+
+// How much more an actor in front of the head counts than one behind it.
+static constexpr float InViewWeight = 4.0f;
+
+void FGeometryStreamingQueue::Enqueue(UStreamableRootComponent* Root)
+{
+	if (Root)
+	{
+		Pending.Add(Root);
+	}
+}
+
+bool FGeometryStreamingQueue::Remove(UStreamableRootComponent* Root)
+{
+	return Pending.Remove(Root) > 0;
+}
+
+void FGeometryStreamingQueue::Reset()
+{
+	Pending.Empty();
+	SentAssets.Empty();
+	Allowance = 0.0;
+}
+
+int64 FGeometryStreamingQueue::TakeUnsentBytes(UStreamableRootComponent* Root)
+{
+	int64 Bytes = 0;
+	for (const auto& n : Root->GetStreamableNodes())
+	{
+		UStreamableNode* Node = n.Value.Get();
+		if (!Node)
+		{
+			continue;
+		}
+		Bytes += BytesPerNode;
+		UStaticMeshComponent* MeshComponent = Node->GetMesh();
+		if (!MeshComponent)
+		{
+			continue;
+		}
+		UStaticMesh* Mesh = MeshComponent->GetStaticMesh();
+		if (Mesh && !SentAssets.Contains(Mesh))
+		{
+			SentAssets.Add(Mesh);
+			Bytes += Mesh->GetNumVertices(0) * BytesPerVertex + Mesh->GetNumTriangles(0) * BytesPerTriangle;
+		}
+		for (int32 i = 0; i < Node->GetNumMaterials(); i++)
+		{
+			UMaterialInterface* Material = Node->GetMaterial(i);
+			if (Material && !SentAssets.Contains(Material))
+			{
+				SentAssets.Add(Material);
+				Bytes += BytesPerMaterial;
+			}
+		}
+		for (UTexture* Texture : Node->GetUsedTextures())
+		{
+			if (Texture && !SentAssets.Contains(Texture))
+			{
+				SentAssets.Add(Texture);
+				Bytes += int64(Texture->GetSurfaceWidth() * Texture->GetSurfaceHeight() * FMath::Max(Texture->GetSurfaceDepth(), 1.0f)) * CompressedBytesPerTexel;
+			}
+		}
+	}
+	return Bytes;
+}
+
+void FGeometryStreamingQueue::Dequeue(const FVector& HeadLocation, const FVector& HeadDirection, float DeltaTime, int64 ThrottleKpS, int32 BufferCutoffSize, TArray<UStreamableRootComponent*>& OutRoots)
+{
+	for (auto i = Pending.CreateIterator(); i; ++i)
+	{
+		if (!i->IsValid())
+		{
+			i.RemoveCurrent();
+		}
+	}
+	if (!Pending.Num())
+	{
+		// Nothing is waiting, so there's nothing to save the allowance for.
+		Allowance = FMath::Min(Allowance, 0.0);
+		return;
+	}
+	struct FRanked
+	{
+		UStreamableRootComponent* Root;
+		int32 Priority;
+		float Importance;
+	};
+	TArray<FRanked> Ranked;
+	Ranked.Reserve(Pending.Num());
+	for (const TWeakObjectPtr<UStreamableRootComponent>& Root : Pending)
+	{
+		const AActor* Actor = Root->GetOwner();
+		float Importance = 0.0f;
+		if (Actor)
+		{
+			FVector Origin, Extent;
+			Actor->GetActorBounds(false, Origin, Extent);
+			const FVector ToActor = Origin - HeadLocation;
+			const float Distance = FMath::Max(ToActor.Size(), 1.0f);
+			// The angular size, roughly in proportion to the actor's size on screen.
+			const float AngularSize = Extent.Size() / Distance;
+			const float Facing = FMath::Max(FVector::DotProduct(ToActor / Distance, HeadDirection), 0.0f);
+			Importance = AngularSize * (1.0f + (InViewWeight - 1.0f) * Facing);
+		}
+		Ranked.Add({ Root.Get(), Root->Priority, Importance });
+	}
+	Ranked.Sort([](const FRanked& A, const FRanked& B)
+	{
+		if (A.Priority != B.Priority)
+		{
+			return A.Priority > B.Priority;
+		}
+		return A.Importance > B.Importance;
+	});
+
+	const bool bThrottled = ThrottleKpS > 0;
+	// Kilobits per second to bytes.
+	const double BytesPerSecond = double(ThrottleKpS) * 1000.0 / 8.0;
+	// Without a cutoff, up to a second's worth is saved or owed.
+	const double MaxAllowance = BufferCutoffSize > 0 ? double(BufferCutoffSize) : BytesPerSecond;
+	if (bThrottled)
+	{
+		Allowance = FMath::Min(Allowance + BytesPerSecond * DeltaTime, MaxAllowance);
+	}
+	const int32 FirstReleased = OutRoots.Num();
+	for (const FRanked& R : Ranked)
+	{
+		if (bThrottled && Allowance <= 0.0)
+		{
+			break;
+		}
+		if (bThrottled)
+		{
+			// One large actor mustn't hold up the rest for longer than the cutoff takes to send.
+			Allowance = FMath::Max(Allowance - double(TakeUnsentBytes(R.Root)), -MaxAllowance);
+		}
+		OutRoots.Add(R.Root);
+	}
+	for (int32 i = FirstReleased; i < OutRoots.Num(); i++)
+	{
+		Pending.Remove(OutRoots[i]);
+	}
+}
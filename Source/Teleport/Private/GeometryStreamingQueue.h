@@ -0,0 +1,44 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UStreamableRootComponent;
+
+/*! The streamable actors waiting to be sent to one client, most important first.
+
+	Actors are ordered by Priority, then by how large they appear from the client's head, favouring those in front of it.
+	The server paces what it sends by the ThrottleKpS and GeometryBufferCutoffSize of its settings, so the queue releases
+	actors in order at about that rate, with the same settings, rather than handing the server everything at once.
+	The estimated size of an actor only counts the meshes, materials and textures that haven't already been sent to this
+	client, as they would be compressed. Unspent allowance, and the debt of an actor larger than what was left, are
+	both limited to GeometryBufferCutoffSize.
+	Game thread only.
+*/
+class FGeometryStreamingQueue
+{
+public:
+	void Enqueue(UStreamableRootComponent* Root);
+	//! Returns false if the root had already left the queue.
+	bool Remove(UStreamableRootComponent* Root);
+	void Reset();
+	bool IsEmpty() const
+	{
+		return Pending.Num() == 0;
+	}
+
+	//! Adds to OutRoots the roots to stream now, most important first.
+	//! ThrottleKpS and BufferCutoffSize are the server's settings. A ThrottleKpS of zero releases everything.
+	void Dequeue(const FVector& HeadLocation, const FVector& HeadDirection, float DeltaTime, int64 ThrottleKpS, int32 BufferCutoffSize, TArray<UStreamableRootComponent*>& OutRoots);
+
+private:
+	//! The bytes needed for the root's meshes, materials and textures that haven't been sent. Marks them as sent.
+	int64 TakeUnsentBytes(UStreamableRootComponent* Root);
+
+	TSet<TWeakObjectPtr<UStreamableRootComponent>> Pending;
+	// The assets already counted against the budget, since the server only sends each once per client.
+	TSet<TWeakObjectPtr<const UObject>> SentAssets;
+	// Bytes that can be sent before the budget runs out. Goes negative when an actor was larger than what was left.
+	double Allowance = 0.0;
+};
@@ -0,0 +1,180 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "NodeTransformSync.h"
+#include "Components/StreamableNode.h"
+#include "GeometrySource.h"
+#include "TeleportServer/PluginMain.h"
+#include "UObject/UObjectGlobals.h"
+
+FNodeTransformSync::~FNodeTransformSync()
+{
+	// At shutdown the components may already be gone, along with their delegates.
+	if (UObjectInitialized())
+	{
+		Reset();
+	}
+}
+
+void FNodeTransformSync::Track(UStreamableNode* Node)
+{
+	USceneComponent* Component = Node ? Node->GetSceneComponent() : nullptr;
+	if (!Component || TrackedNodes.Contains(Component))
+	{
+		return;
+	}
+	FTrackedNode& Tracked = TrackedNodes.Add(Component);
+	Tracked.Node = Node;
+	Tracked.TransformUpdatedHandle = Component->TransformUpdated.AddRaw(this, &FNodeTransformSync::OnTransformUpdated);
+	// Send where it is now, in case it moved before it was tracked.
+	Tracked.bDirty = true;
+	DirtyComponents.Add(Component);
+}
+
+void FNodeTransformSync::Untrack(UStreamableNode* Node)
+{
+	USceneComponent* Component = Node ? Node->GetSceneComponent() : nullptr;
+	FTrackedNode Tracked;
+	if (!Component || !TrackedNodes.RemoveAndCopyValue(Component, Tracked))
+	{
+		return;
+	}
+	Component->TransformUpdated.Remove(Tracked.TransformUpdatedHandle);
+}
+
+void FNodeTransformSync::Reset()
+{
+	for (auto& t : TrackedNodes)
+	{
+		if (USceneComponent* Component = t.Key.Get())
+		{
+			Component->TransformUpdated.Remove(t.Value.TransformUpdatedHandle);
+		}
+	}
+	TrackedNodes.Empty();
+	DirtyComponents.Empty();
+	SettlingComponents.Empty();
+	Batch.Empty();
+}
+
+void FNodeTransformSync::OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags Flags, ETeleportType Teleport)
+{
+	FTrackedNode* Tracked = TrackedNodes.Find(Component);
+	if (Tracked && !Tracked->bDirty)
+	{
+		Tracked->bDirty = true;
+		DirtyComponents.Add(Component);
+	}
+}
+
+// Scale changes smaller than this are not sent.
+static constexpr float ScaleThreshold = 0.001f;
+
+static FVector3f ToVector(const vec3& v)
+{
+	return FVector3f(v.x, v.y, v.z);
+}
+
+static FQuat4f ToQuat(const vec4& q)
+{
+	return FQuat4f(q.x, q.y, q.z, q.w);
+}
+
+float FNodeTransformSync::GetError(const avs::Transform& Transform, const avs::Transform& Sent, float PositionThreshold, float RotationThreshold)
+{
+	const float PositionError = (ToVector(Transform.position) - ToVector(Sent.position)).Size();
+	const float RotationError = ToQuat(Transform.rotation).AngularDistance(ToQuat(Sent.rotation));
+	const float ScaleError = (ToVector(Transform.scale) - ToVector(Sent.scale)).GetAbsMax();
+	return FMath::Max3(PositionError / FMath::Max(PositionThreshold, UE_SMALL_NUMBER)
+		, RotationError / FMath::Max(RotationThreshold, UE_SMALL_NUMBER)
+		, ScaleError / ScaleThreshold);
+}
+
+void FNodeTransformSync::Flush(float PositionThreshold, float RotationThreshold, int32 MaxUpdates)
+{
+	if (!DirtyComponents.Num() && !SettlingComponents.Num())
+	{
+		return;
+	}
+	Batch.Reset();
+	// Nodes that moved within the thresholds, and haven't moved since, are sent where they came to rest.
+	for (const TWeakObjectPtr<USceneComponent>& c : SettlingComponents)
+	{
+		USceneComponent* Component = c.Get();
+		FTrackedNode* Tracked = Component ? TrackedNodes.Find(Component) : nullptr;
+		if (!Tracked || !Tracked->bSettling)
+		{
+			continue;
+		}
+		Tracked->bSettling = false;
+		// Still moving, so it's checked against the thresholds below.
+		if (Tracked->bDirty)
+		{
+			continue;
+		}
+		UStreamableNode* Node = Tracked->Node.Get();
+		if (!Node || !Node->GetUid().Value)
+		{
+			continue;
+		}
+		const avs::Transform Transform = GeometrySource::GetComponentTransform(Component);
+		const float Error = GetError(Transform, Tracked->LastSent, PositionThreshold, RotationThreshold);
+		if (Error > 0.0f)
+		{
+			Batch.Add({ Component, Tracked, Transform, Error });
+		}
+	}
+	SettlingComponents.Reset();
+	for (const TWeakObjectPtr<USceneComponent>& c : DirtyComponents)
+	{
+		USceneComponent* Component = c.Get();
+		FTrackedNode* Tracked = Component ? TrackedNodes.Find(Component) : nullptr;
+		if (!Tracked)
+		{
+			continue;
+		}
+		Tracked->bDirty = false;
+		UStreamableNode* Node = Tracked->Node.Get();
+		if (!Node || !Node->GetUid().Value)
+		{
+			continue;
+		}
+		// Transforms are relative to the parent, so a child moved only by its parent needn't be sent.
+		const avs::Transform Transform = GeometrySource::GetComponentTransform(Component);
+		float Error = MAX_flt;
+		if (Tracked->bSent)
+		{
+			Error = GetError(Transform, Tracked->LastSent, PositionThreshold, RotationThreshold);
+			// Still within the thresholds of what the server has. It'll be checked again if it moves further,
+			// or sent where it stops if it doesn't.
+			if (Error <= 1.0f)
+			{
+				if (Error > 0.0f)
+				{
+					Tracked->bSettling = true;
+					SettlingComponents.Add(Component);
+				}
+				continue;
+			}
+		}
+		Batch.Add({ Component, Tracked, Transform, Error });
+	}
+	DirtyComponents.Reset();
+	if (MaxUpdates > 0 && Batch.Num() > MaxUpdates)
+	{
+		// Those furthest from what was last sent go first, and the rest wait for the next frame.
+		Batch.Sort([](const FMovedNode& A, const FMovedNode& B) { return A.Error > B.Error; });
+		for (int32 i = MaxUpdates; i < Batch.Num(); i++)
+		{
+			Batch[i].Tracked->bDirty = true;
+			DirtyComponents.Add(Batch[i].Component);
+		}
+		Batch.SetNum(MaxUpdates, false);
+	}
+	// The server has no bulk update, so the batch is sent in one pass.
+	for (const FMovedNode& m : Batch)
+	{
+		Server_UpdateNodeTransform(m.Tracked->Node->GetUid().Value, m.Transform);
+		m.Tracked->LastSent = m.Transform;
+		m.Tracked->bSent = true;
+	}
+}
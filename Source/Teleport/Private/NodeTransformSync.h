@@ -0,0 +1,62 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "libavstream/common_maths.h"
+
+class UStreamableNode;
+
+/*! Sends the transforms of movable nodes to the server, once per frame and only for nodes that moved.
+
+	Each tracked node's scene component reports its own movement. The moved nodes' transforms are gathered into one
+	array, and compared with what was last sent. Only those that have moved or turned beyond a threshold are sent,
+	furthest first, up to a limit per frame; the rest wait for a later frame.
+	A node that comes to rest within the thresholds is sent once more where it stopped, so the server isn't left with it
+	slightly out. Otherwise nothing is done for nodes that stayed still.
+	Game thread only.
+*/
+class FNodeTransformSync
+{
+public:
+	~FNodeTransformSync();
+
+	void Track(UStreamableNode* Node);
+	void Untrack(UStreamableNode* Node);
+	void Reset();
+	//! Sends the transforms of the nodes that have moved since they were last sent.
+	//!	PositionThreshold : in metres.
+	//!	RotationThreshold : in radians.
+	//!	MaxUpdates : the most transforms to send; zero for no limit.
+	void Flush(float PositionThreshold, float RotationThreshold, int32 MaxUpdates);
+
+private:
+	void OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags Flags, ETeleportType Teleport);
+	//! How far Transform is from Sent, relative to the thresholds.
+	static float GetError(const avs::Transform& Transform, const avs::Transform& Sent, float PositionThreshold, float RotationThreshold);
+
+	struct FTrackedNode
+	{
+		TWeakObjectPtr<UStreamableNode> Node;
+		FDelegateHandle TransformUpdatedHandle;
+		avs::Transform LastSent;
+		bool bSent = false;
+		bool bDirty = false;
+		//! Moved, but not beyond the thresholds, since it was last sent.
+		bool bSettling = false;
+	};
+	TMap<TWeakObjectPtr<USceneComponent>, FTrackedNode> TrackedNodes;
+	TArray<TWeakObjectPtr<USceneComponent>> DirtyComponents;
+	TArray<TWeakObjectPtr<USceneComponent>> SettlingComponents;
+	struct FMovedNode
+	{
+		TWeakObjectPtr<USceneComponent> Component;
+		FTrackedNode* Tracked;
+		avs::Transform Transform;
+		//! How far beyond the thresholds the node has moved; greater than one means it must be sent.
+		float Error;
+	};
+	// Reused each frame, so the batch doesn't reallocate.
+	TArray<FMovedNode> Batch;
+};
@@ -12,6 +12,7 @@ namespace teleport::server
 class FSceneInterface;
 class UTexture;
 class ATeleportMonitor;
+class FEncodeTimings;
 struct FUnrealCasterEncoderSettings;
 struct FSurfaceTexture
 {
@@ -30,4 +31,10 @@ public:
 	virtual void PrepareFrame(FSceneInterface* InScene, UTexture* InSourceTexture, FTransform& CameraTransform, const TArray<bool>& BlockIntersectionFlags) = 0;
 	virtual void EncodeFrame(FSceneInterface* InScene, UTexture* InSourceTexture, FTransform& CameraTransform, bool forceIDR) = 0;
 	virtual FSurfaceTexture *GetSurfaceTexture() = 0;
+	virtual const FUnrealCasterEncoderSettings& GetSettings() const = 0;
+	virtual avs::uid GetClientId() const = 0;
+	//! Copies the source's prepared frame, if it was prepared for an identical stream. Returns false if the streams differ.
+	virtual bool CopyFrame(IEncodePipeline* Source) = 0;
+	//! Render thread: where the GPU work written into this pipeline's frames is timed.
+	virtual FEncodeTimings* GetTimings() = 0;
 };
@@ -38,26 +38,38 @@
 #include "HAL/UnrealMemory.h"
 #include "Containers/DynamicRHIResourceArray.h"
 #include "GlobalShader.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "ShaderParameterStruct.h"
 #include "Pipelines/EncodePipelineInterface.h"
 #include "TeleportServer/ServerSettings.h"
 #include "TeleportServer/Exports.h"
 #include "TeleportServer/PluginClient.h"
 
-DECLARE_FLOAT_COUNTER_STAT(TEXT("TeleportEncodePipelineMonoscopic"), Stat_GPU_TeleportEncodePipelineMonoscopic, STATGROUP_GPU);
-
-#define GETSAFERHISHADER_COMPUTE(Shader) \
-	Shader.GetComputeShader()
+DECLARE_GPU_STAT_NAMED(TeleportDecomposeCubemap, TEXT("Teleport Decompose Cubemap"));
+DECLARE_CYCLE_STAT(TEXT("Teleport Encode Submit"), STAT_TeleportEncodeSubmit, STATGROUP_TeleportEncode);
 
 enum class EProjectCubemapVariant
 {
-	EncodeCameraPosition,
-	DecomposeCubemaps,
-	DecomposeDepth
+	// Colour, depth and camera position in a single dispatch.
+	DecomposeCubemaps
 };
 
 class FBaseProjectCubemapCS : public FGlobalShader
 {
 public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2DArray<float4>, RWInputCubeAsArray)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, RWOutputColorTexture)
+		// The block cull flags are uploaded outside the graph, so they're bound directly rather than tracked.
+		SHADER_PARAMETER_SRV(StructuredBuffer<int4>, CullFlags)
+		SHADER_PARAMETER(int32, BlocksPerFaceAcross)
+		SHADER_PARAMETER(FIntPoint, Offset)
+		SHADER_PARAMETER(FIntPoint, DepthOffset)
+		SHADER_PARAMETER(FIntPoint, CameraPositionOffset)
+		SHADER_PARAMETER(FVector3f, CubemapCameraPositionMetres)
+	END_SHADER_PARAMETER_STRUCT()
+
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters &Parameters)
 	{
 		return Parameters.Platform == EShaderPlatform::SP_PCD3D_SM5;
@@ -75,14 +87,6 @@ public:
 	FBaseProjectCubemapCS(const ShaderMetaType::CompiledShaderInitializerType &Initializer)
 		: FGlobalShader(Initializer)
 	{
-		InputCubeMap.Bind(Initializer.ParameterMap, TEXT("InputCubeMap"));
-		RWInputCubeAsArray.Bind(Initializer.ParameterMap, TEXT("InputCubeAsArray"));
-		InputBlockCullFlagStructBuffer.Bind(Initializer.ParameterMap, TEXT("CullFlags"));
-		DefaultSampler.Bind(Initializer.ParameterMap, TEXT("DefaultSampler"));
-		OutputColorTexture.Bind(Initializer.ParameterMap, TEXT("OutputColorTexture"));
-		Offset.Bind(Initializer.ParameterMap, TEXT("Offset"));
-		BlocksPerFaceAcross.Bind(Initializer.ParameterMap, TEXT("BlocksPerFaceAcross"));
-		CubemapCameraPositionMetres.Bind(Initializer.ParameterMap, TEXT("CubemapCameraPositionMetres"));
 	}
 	static const uint32 kThreadGroupSize = 16;
 	static const bool bWriteDepth = true;
@@ -90,14 +94,6 @@ public:
 
 protected:
 	DECLARE_INLINE_TYPE_LAYOUT(FBaseProjectCubemapCS, NonVirtual);
-	LAYOUT_FIELD(FShaderResourceParameter, InputCubeMap);
-	LAYOUT_FIELD(FRWShaderParameter, RWInputCubeAsArray);
-	LAYOUT_FIELD(FShaderResourceParameter, InputBlockCullFlagStructBuffer);
-	LAYOUT_FIELD(FShaderResourceParameter, DefaultSampler);
-	LAYOUT_FIELD(FRWShaderParameter, OutputColorTexture);
-	LAYOUT_FIELD(FShaderParameter, CubemapCameraPositionMetres);
-	LAYOUT_FIELD(FShaderParameter, Offset);
-	LAYOUT_FIELD(FShaderParameter, BlocksPerFaceAcross);
 };
 
 template<EProjectCubemapVariant Variant>
@@ -105,101 +101,11 @@ class FProjectCubemapCS : public FBaseProjectCubemapCS
 { 
 	DECLARE_SHADER_TYPE(FProjectCubemapCS, Global);
 public:
-	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
-	{
-		return Parameters.Platform == EShaderPlatform::SP_PCD3D_SM5;
-	}
-	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
-	{
-		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZEX"), kThreadGroupSize);
-		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZEY"), kThreadGroupSize);
-		OutEnvironment.SetDefine(TEXT("WRITE_DEPTH"), bWriteDepth ? 1 : 0);
-		OutEnvironment.SetDefine(TEXT("WRITE_DEPTH_LINEAR"), bWriteLinearDepth ? 1 : 0);
-	}
-
-	FProjectCubemapCS() = default;
-	FProjectCubemapCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
-		: FBaseProjectCubemapCS(Initializer)
-	{
-		InputCubeMap.Bind(Initializer.ParameterMap, TEXT("InputCubeMap"));
-		RWInputCubeAsArray.Bind(Initializer.ParameterMap, TEXT("InputCubeAsArray"));
-		InputBlockCullFlagStructBuffer.Bind(Initializer.ParameterMap, TEXT("CullFlags"));
-		DefaultSampler.Bind(Initializer.ParameterMap, TEXT("DefaultSampler"));
-		OutputColorTexture.Bind(Initializer.ParameterMap, TEXT("OutputColorTexture"));
-		Offset.Bind(Initializer.ParameterMap, TEXT("Offset"));
-		BlocksPerFaceAcross.Bind(Initializer.ParameterMap, TEXT("BlocksPerFaceAcross"));
-		CubemapCameraPositionMetres.Bind(Initializer.ParameterMap, TEXT("CubemapCameraPositionMetres"));
-	}
-	 
-	void SetInputsAndOutputs(
-		FRHICommandList& RHICmdList,
-		FTextureRHIRef InputCubeMapTextureRef,
-		FUnorderedAccessViewRHIRef InputCubeMapTextureUAVRef,
-		FShaderResourceViewRHIRef InputBlockCullFlagSRVRef,
-		FTexture2DRHIRef OutputColorTextureRef,
-		FUnorderedAccessViewRHIRef OutputColorTextureUAVRef)
-	{
-		auto *ShaderMap = GetGlobalShaderMap(ERHIFeatureLevel::SM5);
-		TShaderMapRef<FProjectCubemapCS<Variant>> smr(ShaderMap);
-		FRHIComputeShader *ShaderRHI = smr.GetComputeShader();
-		if (bDecomposeCubemaps)
-		{
-			RWInputCubeAsArray.SetTexture(RHICmdList, ShaderRHI, InputCubeMapTextureRef, InputCubeMapTextureUAVRef);
-			check(RWInputCubeAsArray.IsUAVBound());
-			SetSRVParameter(RHICmdList, ShaderRHI, InputBlockCullFlagStructBuffer, InputBlockCullFlagSRVRef);
-		}
-		else
-		{
-			SetTextureParameter(RHICmdList, ShaderRHI, InputCubeMap, DefaultSampler, TStaticSamplerState<SF_Bilinear>::GetRHI(), InputCubeMapTextureRef);
-		}
-		OutputColorTexture.SetTexture(RHICmdList, ShaderRHI, OutputColorTextureRef, OutputColorTextureUAVRef);
-
-	}
-
-	void SetParameters(
-		FRHICommandList& RHICmdList,
-		const FIntPoint& InOffset,
-		const FVector& InCubemapCameraPositionMetres,
-		uint32 InBlocksPerFaceAcross)
-	{
-		auto *ShaderMap = GetGlobalShaderMap(ERHIFeatureLevel::SM5);
-		TShaderMapRef<FProjectCubemapCS<Variant>> smr(ShaderMap);
-		FRHIComputeShader *ShaderRHI = smr.GetComputeShader();
-		SetShaderValue(RHICmdList, ShaderRHI, Offset, InOffset);
-		FVector3f campos = {(float)InCubemapCameraPositionMetres.X, (float)InCubemapCameraPositionMetres.Y, (float)InCubemapCameraPositionMetres.Z};
-		SetShaderValue(RHICmdList, ShaderRHI, CubemapCameraPositionMetres, campos);
-		SetShaderValue(RHICmdList, ShaderRHI, BlocksPerFaceAcross, InBlocksPerFaceAcross);
-	}
-
-	void UnsetParameters(FRHICommandList& RHICmdList)
-	{
-		auto *ShaderMap = GetGlobalShaderMap(ERHIFeatureLevel::SM5);
-		TShaderMapRef<FProjectCubemapCS<Variant>> smr(ShaderMap);
-		FRHIComputeShader *ShaderRHI = smr.GetComputeShader();
-		OutputColorTexture.UnsetUAV(RHICmdList, ShaderRHI);
-		RWInputCubeAsArray.UnsetUAV(RHICmdList, ShaderRHI);
-	}
-	/*
-	virtual bool Serialize(FArchive& Ar) override
-	{
-		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
-		Ar << InputCubeMap;
-		Ar << RWInputCubeAsArray;
-		Ar << InputBlockCullFlagStructBuffer;
-		Ar << DefaultSampler;
-		Ar << OutputColorTexture;
-		Ar << Offset;
-		Ar << BlocksPerFaceAcross;
-		Ar << CubemapCameraPositionMetres;
-		return bShaderHasOutdatedParameters;
-	}*/
-	static const bool bDecomposeCubemaps = (Variant == EProjectCubemapVariant::DecomposeCubemaps||Variant==EProjectCubemapVariant::DecomposeDepth);
+	using FParameters = FBaseProjectCubemapCS::FParameters;
+	SHADER_USE_PARAMETER_STRUCT(FProjectCubemapCS, FBaseProjectCubemapCS);
 };
 
-IMPLEMENT_SHADER_TYPE(, FProjectCubemapCS<EProjectCubemapVariant::EncodeCameraPosition>, TEXT("/Plugin/Teleport/Private/ProjectCubemap.usf"), TEXT("EncodeCameraPositionCS"), SF_Compute)
 IMPLEMENT_SHADER_TYPE(, FProjectCubemapCS<EProjectCubemapVariant::DecomposeCubemaps>, TEXT("/Plugin/Teleport/Private/ProjectCubemap.usf"), TEXT("DecomposeCS"), SF_Compute)
-IMPLEMENT_SHADER_TYPE(, FProjectCubemapCS<EProjectCubemapVariant::DecomposeDepth>, TEXT("/Plugin/Teleport/Private/ProjectCubemap.usf"), TEXT("DecomposeDepthCS"), SF_Compute)
 
 static inline FVector2D CreateWorldZToDeviceZTransform(float FOV)
 {
@@ -235,6 +141,8 @@ void FEncodePipelineMonoscopic::Initialise(avs::uid id,const FUnrealCasterEncode
 	Settings = InSettings;
 	Monitor = InMonitor;
 	WorldZToDeviceZTransform = CreateWorldZToDeviceZTransform(FMath::DegreesToRadians(90.0f));
+	// The new buffers are empty, so the first frame's flags must be sent.
+	LastBlockIntersectionFlags.Empty();
 
 	ENQUEUE_RENDER_COMMAND(TeleportInitializeEncodePipeline)(
 		[this](FRHICommandListImmediate& RHICmdList)
@@ -279,11 +187,19 @@ void FEncodePipelineMonoscopic::PrepareFrame(FSceneInterface* InScene, UTexture*
 
 	auto SourceTarget = CastChecked<UTextureRenderTargetCube>(InSourceTexture);
 	FTextureRenderTargetResource* TargetResource = SourceTarget->GameThread_GetRenderTargetResource();
+	// Only copy the flags to the render thread when they have changed.
+	TOptional<TArray<bool>> ChangedFlags;
+	if (BlockIntersectionFlags != LastBlockIntersectionFlags)
+	{
+		LastBlockIntersectionFlags = BlockIntersectionFlags;
+		ChangedFlags = BlockIntersectionFlags;
+	}
+	FrameCaptureTime = FPlatformTime::Seconds();
 	ENQUEUE_RENDER_COMMAND(TeleportPrepareFrame)(
-		[this, CameraTransform, BlockIntersectionFlags, TargetResource, FeatureLevel](FRHICommandListImmediate& RHICmdList)
+		[this, CameraTransform, ChangedFlags = MoveTemp(ChangedFlags), TargetResource, FeatureLevel](FRHICommandListImmediate& RHICmdList)
 		{
 			SCOPED_DRAW_EVENT(RHICmdList, TeleportEncodePipelineMonoscopicPrepare);
-			PrepareFrame_RenderThread(RHICmdList, TargetResource, FeatureLevel, CameraTransform.GetTranslation(), BlockIntersectionFlags);
+			PrepareFrame_RenderThread(RHICmdList, TargetResource, FeatureLevel, CameraTransform.GetTranslation(), ChangedFlags.GetPtrOrNull());
 		}
 	);
 }
@@ -301,15 +217,58 @@ void FEncodePipelineMonoscopic::EncodeFrame(FSceneInterface* InScene, UTexture*
 	auto SourceTarget = CastChecked<UTextureRenderTargetCube>(InSourceTexture);
 	FTextureRenderTargetResource* TargetResource = SourceTarget->GameThread_GetRenderTargetResource();
 
+	const double CaptureTime = FrameCaptureTime;
 	ENQUEUE_RENDER_COMMAND(TeleportEncodeFrame)(
-		[this, CameraTransform, forceIDR](FRHICommandListImmediate& RHICmdList)
+		[this, CaptureTime, CameraTransform, forceIDR](FRHICommandListImmediate& RHICmdList)
 		{
 			SCOPED_DRAW_EVENT(RHICmdList, TeleportEncodePipelineMonoscopic);
-			EncodeFrame_RenderThread(RHICmdList, CameraTransform, forceIDR);
+			EncodeFrame_RenderThread(RHICmdList, CaptureTime, CameraTransform, forceIDR);
 		}
 	);
 }
 	
+bool FEncodePipelineMonoscopic::CopyFrame(IEncodePipeline* Source)
+{
+	if (!Source || Source == this)
+	{
+		return false;
+	}
+	const FUnrealCasterEncoderSettings& SourceSettings = Source->GetSettings();
+	if (SourceSettings.FrameWidth != Settings.FrameWidth || SourceSettings.FrameHeight != Settings.FrameHeight || SourceSettings.bDecomposeCube != Settings.bDecomposeCube)
+	{
+		return false;
+	}
+	// The decomposed frame contains the camera position, in the client's axes.
+	if (Client_GetAxesStandard(Source->GetClientId()) != Client_GetAxesStandard(clientId))
+	{
+		return false;
+	}
+	FSurfaceTexture* SourceSurfaceTexture = Source->GetSurfaceTexture();
+	FrameCaptureTime = FPlatformTime::Seconds();
+	ENQUEUE_RENDER_COMMAND(TeleportCopyFrame)(
+		[this, SourceSurfaceTexture](FRHICommandListImmediate& RHICmdList)
+		{
+			SCOPED_DRAW_EVENT(RHICmdList, TeleportEncodePipelineMonoscopicCopyFrame);
+			CopyFrame_RenderThread(RHICmdList, SourceSurfaceTexture);
+		}
+	);
+	return true;
+}
+
+void FEncodePipelineMonoscopic::CopyFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FSurfaceTexture* SourceSurfaceTexture)
+{
+	FRHITexture* SourceTexture = SourceSurfaceTexture->Texture;
+	FRHITexture* DestTexture = ColorSurfaceTexture.Texture;
+	if (!SourceTexture || !DestTexture || SourceTexture->GetDesc().Format != DestTexture->GetDesc().Format)
+	{
+		return;
+	}
+	RHICmdList.Transition({ FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc), FRHITransitionInfo(DestTexture, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+	RHICmdList.CopyTexture(SourceTexture, DestTexture, FRHICopyTextureInfo());
+	// The surfaces are written by the decompose shaders, so leave them as those leave them.
+	RHICmdList.Transition({ FRHITransitionInfo(SourceTexture, ERHIAccess::CopySrc, ERHIAccess::UAVCompute), FRHITransitionInfo(DestTexture, ERHIAccess::CopyDest, ERHIAccess::UAVCompute) });
+}
+
 void FEncodePipelineMonoscopic::Initialize_RenderThread(FRHICommandListImmediate& RHICmdList)
 {
 	FTeleportRHI RHI(RHICmdList);
@@ -381,17 +340,69 @@ void FEncodePipelineMonoscopic::Initialize_RenderThread(FRHICommandListImmediate
 	params.inputSurfaceResource = ColorSurfaceTexture.Texture->GetNativeResource();
 
 	Client_SetVideoEncodeParams(clientId,params);
+
+	Timings.Initialise_RenderThread(clientId, Monitor && Monitor->bLogEncodeTimings);
+
+	CreateBlockCullFlagBuffers_RenderThread(DefaultBlockCullFlagCapacity);
+}
+
+void FEncodePipelineMonoscopic::CreateBlockCullFlagBuffers_RenderThread(uint32 NumFlags)
+{
+	for (int32 i = 0; i < NumBlockCullFlagBuffers; i++)
+	{
+		FRHIResourceCreateInfo CreateInfo(TEXT("BlockCullFlagSB"));
+		BlockCullFlagBuffers[i] = RHICreateStructuredBuffer(
+			sizeof(FShaderFlag),
+			NumFlags * sizeof(FShaderFlag),
+			BUF_ShaderResource | BUF_Dynamic,
+			CreateInfo
+		);
+		BlockCullFlagSRVs[i] = RHICreateShaderResourceView(BlockCullFlagBuffers[i]);
+	}
+	BlockCullFlagCapacity = NumFlags;
+	CurrentBlockCullFlagBuffer = 0;
+}
+
+void FEncodePipelineMonoscopic::UpdateBlockCullFlags_RenderThread(FRHICommandListImmediate& RHICmdList, const TArray<bool>& BlockIntersectionFlags)
+{
+	const uint32 NumFlags = BlockIntersectionFlags.Num();
+	if (NumFlags > BlockCullFlagCapacity)
+	{
+		CreateBlockCullFlagBuffers_RenderThread(NumFlags);
+	}
+	CurrentBlockCullFlagBuffer = (CurrentBlockCullFlagBuffer + 1) % NumBlockCullFlagBuffers;
+	NumBlockCullFlags = NumFlags;
+	if (!NumFlags)
+	{
+		return;
+	}
+	FShaderFlag* Flags = (FShaderFlag*)RHICmdList.LockBuffer(BlockCullFlagBuffers[CurrentBlockCullFlagBuffer], 0, NumFlags * sizeof(FShaderFlag), RLM_WriteOnly);
+	for (uint32 i = 0; i < NumFlags; i++)
+	{
+		Flags[i] = { BlockIntersectionFlags[i], 0, 0, 0 };
+	}
+	RHICmdList.UnlockBuffer(BlockCullFlagBuffers[CurrentBlockCullFlagBuffer]);
 }
 	
 void FEncodePipelineMonoscopic::Release_RenderThread(FRHICommandListImmediate& RHICmdList)
 {
 	//Pipeline.Reset();
 
+	Timings.Release_RenderThread();
+
 	ColorSurfaceTexture.Texture.SafeRelease();
 	ColorSurfaceTexture.UAV.SafeRelease();
 
 	DepthSurfaceTexture.Texture.SafeRelease();
 	DepthSurfaceTexture.UAV.SafeRelease();
+
+	for (int32 i = 0; i < NumBlockCullFlagBuffers; i++)
+	{
+		BlockCullFlagSRVs[i].SafeRelease();
+		BlockCullFlagBuffers[i].SafeRelease();
+	}
+	BlockCullFlagCapacity = 0;
+	NumBlockCullFlags = 0;
 } 
 
 void FEncodePipelineMonoscopic::CullHiddenCubeSegments_RenderThread(FRHICommandListImmediate& RHICmdList, ERHIFeatureLevel::Type FeatureLevel, teleport::server::CameraInfo CameraInfo, int32 FaceSize, uint32 Divisor)
@@ -405,22 +416,29 @@ void FEncodePipelineMonoscopic::PrepareFrame_RenderThread(
 	FTextureRenderTargetResource* TargetResource,
 	ERHIFeatureLevel::Type FeatureLevel,
 	FVector CameraPosition,
-	TArray<bool> BlockIntersectionFlags)
+	const TArray<bool>* ChangedBlockIntersectionFlags)
 {
-	if (!UnorderedAccessViewRHIRef || !UnorderedAccessViewRHIRef->IsValid() || TargetResource->TextureRHI != SourceCubemapRHI)
+	if (ChangedBlockIntersectionFlags)
 	{
-		UnorderedAccessViewRHIRef = RHICreateUnorderedAccessView(TargetResource->TextureRHI, 0);
-		SourceCubemapRHI = TargetResource->TextureRHI;
+		UpdateBlockCullFlags_RenderThread(RHICmdList, *ChangedBlockIntersectionFlags);
 	}
+	if (Settings.bDecomposeCube)
 	{
-		if (Settings.bDecomposeCube)
-		{
-			DispatchDecomposeCubemapShader(RHICmdList, TargetResource->TextureRHI, UnorderedAccessViewRHIRef, FeatureLevel, CameraPosition, BlockIntersectionFlags);
-		}
+		// This is the number of segments each cube face is split into for culling
+		uint32 BlocksPerFaceAcross = (uint32)FMath::Sqrt(float(NumBlockCullFlags)/6.0f);
+		FRHIRenderQuery* BeginQuery = nullptr;
+		FRHIRenderQuery* EndQuery = nullptr;
+		Timings.BeginGPUWork_RenderThread(FEncodeTimings::EGPUWork::Decompose, BeginQuery, EndQuery);
+		FRDGBuilder GraphBuilder(RHICmdList);
+		FEncodeTimings::AddTimestampPass(GraphBuilder, BeginQuery);
+		AddDecomposeCubemapPass(GraphBuilder, TargetResource->TextureRHI, FeatureLevel, CameraPosition, BlockCullFlagSRVs[CurrentBlockCullFlagBuffer], BlocksPerFaceAcross
+			, !BeginQuery);
+		FEncodeTimings::AddTimestampPass(GraphBuilder, EndQuery);
+		GraphBuilder.Execute();
 	}
 }
 	
-void FEncodePipelineMonoscopic::EncodeFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FTransform CameraTransform, bool forceIDR)
+void FEncodePipelineMonoscopic::EncodeFrame_RenderThread(FRHICommandListImmediate& RHICmdList, double CaptureTime, FTransform CameraTransform, bool forceIDR)
 {
 //	check(Pipeline.IsValid());
 
@@ -435,7 +453,15 @@ void FEncodePipelineMonoscopic::EncodeFrame_RenderThread(FRHICommandListImmediat
 
 	//avs::ConvertTransform(avs::AxesStandard::UnrealStyle, ClientNetworkContext->axesStandard, CamTransform);
 	// TODO: extra data...
-	bool result =Client_VideoEncodePipelineProcess(clientId,forceIDR);
+	bool result;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TeleportEncodeSubmit);
+		CSV_SCOPED_TIMING_STAT(Teleport, EncodeSubmit);
+		const double SubmitStart = FPlatformTime::Seconds();
+		result = Client_VideoEncodePipelineProcess(clientId,forceIDR);
+		const double SubmitEnd = FPlatformTime::Seconds();
+		Timings.RecordEncode_RenderThread(SubmitEnd - SubmitStart, SubmitEnd - CaptureTime);
+	}
 	//bool result = Pipeline->process(nullptr,0, forceIDR);
 	if (!result)
 	{
@@ -443,100 +469,44 @@ void FEncodePipelineMonoscopic::EncodeFrame_RenderThread(FRHICommandListImmediat
 	}
 }
 
-template<typename ShaderType>
-void FEncodePipelineMonoscopic::DispatchProjectCubemapShader(FRHICommandListImmediate& RHICmdList, FTextureRHIRef TextureRHI, FUnorderedAccessViewRHIRef TextureUAVRHI, ERHIFeatureLevel::Type FeatureLevel)
-{
-	const uint32 NumThreadGroupsX = Settings.FrameWidth / ShaderType::kThreadGroupSize;
-	const uint32 NumThreadGroupsY = Settings.FrameHeight / ShaderType::kThreadGroupSize;
-	const uint32 NumThreadGroupsZ = Settings.bDecomposeCube ? 6 : 1;
-
-	TShaderMap<FGlobalShaderType>* GlobalShaderMap = GetGlobalShaderMap(FeatureLevel);
-
-	TShaderMapRef<ShaderType> ComputeShader(GlobalShaderMap);
-	ComputeShader->SetParameters(RHICmdList, TextureRHI, TextureUAVRHI,
-		ColorSurfaceTexture.Texture, ColorSurfaceTexture.UAV,
-		 FIntPoint(0, 0));
-	SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(ComputeShader));
-	DispatchComputeShader(RHICmdList, *ComputeShader, NumThreadGroupsX, NumThreadGroupsY, NumThreadGroupsZ);
-
-	ComputeShader->UnsetParameters(RHICmdList);
-}
-
-void FEncodePipelineMonoscopic::DispatchDecomposeCubemapShader(FRHICommandListImmediate& RHICmdList, FTextureRHIRef TextureRHI
-	, FUnorderedAccessViewRHIRef TextureUAVRHI, ERHIFeatureLevel::Type FeatureLevel
-	,FVector CameraPosition, const TArray<bool>& BlockIntersectionFlags)
+void FEncodePipelineMonoscopic::AddDecomposeCubemapPass(FRDGBuilder& GraphBuilder, FRHITexture* CubemapRHI, ERHIFeatureLevel::Type FeatureLevel
+	,FVector CameraPosition, FRHIShaderResourceView* BlockCullFlagSRV, uint32 BlocksPerFaceAcross
+	,bool bAllowAsyncCompute)
 {
 	FVector  t = CameraPosition *0.01f;
 	vec3 pos_m ={(float)t.X,(float)t.Y,(float)t.Z};
 	teleport::server::ConvertPosition(avs::AxesStandard::UnrealStyle, Client_GetAxesStandard(clientId), pos_m);
-	const FVector &CameraPositionMetres =*((const FVector*)&pos_m);
+	const FVector3f CameraPositionMetres(pos_m.x, pos_m.y, pos_m.z);
 	FGlobalShaderMap *GlobalShaderMap = GetGlobalShaderMap(FeatureLevel);
 	typedef FProjectCubemapCS<EProjectCubemapVariant::DecomposeCubemaps> ShaderType;
-	typedef FProjectCubemapCS<EProjectCubemapVariant::DecomposeDepth> DepthShaderType;
-	typedef FProjectCubemapCS<EProjectCubemapVariant::EncodeCameraPosition> EncodeCameraPositionShaderType;
-	
-	TResourceArray<FShaderFlag> BlockCullFlags;
-
-	for (auto& Flag : BlockIntersectionFlags)
-	{
-		BlockCullFlags.Add({ Flag, 0, 0, 0 });
-	}
-
-	FRHIResourceCreateInfo CreateInfo(TEXT("BlockCullFlagSB"));
-	CreateInfo.ResourceArray = &BlockCullFlags;
-
-	FBufferRHIRef BlockCullFlagSB = RHICreateStructuredBuffer(
-		sizeof(FShaderFlag),
-		BlockCullFlags.Num() * sizeof(FShaderFlag),
-		BUF_ShaderResource,
-		CreateInfo
-	);
 
-	FShaderResourceViewRHIRef BlockCullFlagSRV = RHICreateShaderResourceView(BlockCullFlagSB);
-
-	// This is the number of segments each cube face is split into for culling
-	uint32 BlocksPerFaceAcross = (uint32)FMath::Sqrt(float(BlockCullFlags.Num())/6.0f);
-
-	int W = SourceCubemapRHI->GetSizeXYZ().X;
-	{
-		const uint32 NumThreadGroupsX = W / ShaderType::kThreadGroupSize;
-		const uint32 NumThreadGroupsY = W / ShaderType::kThreadGroupSize;
-		const uint32 NumThreadGroupsZ = CubeFace_MAX;
-
-		TShaderMapRef<ShaderType> ComputeShader(GlobalShaderMap);
-		ComputeShader->SetInputsAndOutputs(RHICmdList, TextureRHI, TextureUAVRHI,
-			BlockCullFlagSRV, ColorSurfaceTexture.Texture, ColorSurfaceTexture.UAV);
-		ComputeShader->SetParameters(RHICmdList, FIntPoint(0, 0), CameraPositionMetres, BlocksPerFaceAcross);
-		SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(ComputeShader));
-		DispatchComputeShader(RHICmdList, ComputeShader.GetShader(), NumThreadGroupsX, NumThreadGroupsY, NumThreadGroupsZ);
-		ComputeShader->UnsetParameters(RHICmdList);
-	}
-
-	{
-		const uint32 NumThreadGroupsX = W/2 / ShaderType::kThreadGroupSize;
-		const uint32 NumThreadGroupsY = W/2 / ShaderType::kThreadGroupSize;
-		const uint32 NumThreadGroupsZ = CubeFace_MAX;
-		TShaderMapRef<DepthShaderType> DepthShader(GlobalShaderMap);
-		DepthShader->SetInputsAndOutputs(RHICmdList, TextureRHI, TextureUAVRHI,
-			BlockCullFlagSRV, ColorSurfaceTexture.Texture, ColorSurfaceTexture.UAV);
-		DepthShader->SetParameters(RHICmdList, FIntPoint(0, W * 2), CameraPositionMetres, BlocksPerFaceAcross);
-		SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(DepthShader));
-		DispatchComputeShader(RHICmdList, DepthShader.GetShader(), NumThreadGroupsX, NumThreadGroupsY, NumThreadGroupsZ);
-		DepthShader->UnsetParameters(RHICmdList);
-	}
-
-	{
-		const uint32 NumThreadGroupsX = 4;
-		const uint32 NumThreadGroupsY = 1;
-		const uint32 NumThreadGroupsZ = 1;
-		TShaderMapRef<EncodeCameraPositionShaderType> EncodePosShader(GlobalShaderMap);
-		EncodePosShader->SetInputsAndOutputs(RHICmdList, TextureRHI, TextureUAVRHI,
-			BlockCullFlagSRV, ColorSurfaceTexture.Texture, ColorSurfaceTexture.UAV);
-		EncodePosShader->SetParameters(RHICmdList, FIntPoint(W*3-(32*4), W * 3-(3*8)), CameraPositionMetres, BlocksPerFaceAcross);
-		SetComputePipelineState(RHICmdList, GETSAFERHISHADER_COMPUTE(EncodePosShader));
-		DispatchComputeShader(RHICmdList, EncodePosShader.GetShader(), NumThreadGroupsX, NumThreadGroupsY, NumThreadGroupsZ);
-		EncodePosShader->UnsetParameters(RHICmdList);
-	}
-	
+	RDG_EVENT_SCOPE(GraphBuilder, "TeleportDecomposeCubemap");
+	RDG_GPU_STAT_SCOPE(GraphBuilder, TeleportDecomposeCubemap);
+	FRDGTextureRef Cubemap = RegisterExternalTexture(GraphBuilder, CubemapRHI, TEXT("TeleportSourceCubemap"));
+	FRDGTextureRef Surface = RegisterExternalTexture(GraphBuilder, ColorSurfaceTexture.Texture, TEXT("TeleportColorSurface"));
+	// On hardware that overlaps async compute well, this can run alongside graphics work, unless it's being timed.
+	const ERDGPassFlags PassFlags = bAllowAsyncCompute && GSupportsEfficientAsyncCompute ? ERDGPassFlags::AsyncCompute : ERDGPassFlags::Compute;
+
+	int W = CubemapRHI->GetSizeXYZ().X;
+	FBaseProjectCubemapCS::FParameters* Parameters = GraphBuilder.AllocParameters<FBaseProjectCubemapCS::FParameters>();
+	Parameters->RWInputCubeAsArray = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(Cubemap));
+	Parameters->RWOutputColorTexture = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(Surface));
+	Parameters->CullFlags = BlockCullFlagSRV;
+	Parameters->BlocksPerFaceAcross = BlocksPerFaceAcross;
+	// Colour at the top, half-size depth below it, and the camera position at the bottom right.
+	Parameters->Offset = FIntPoint(0, 0);
+	Parameters->DepthOffset = FIntPoint(0, W * 2);
+	Parameters->CameraPositionOffset = FIntPoint(W*3-(32*4), W * 3-(3*8));
+	Parameters->CubemapCameraPositionMetres = CameraPositionMetres;
+
+	// The camera position needs two groups in the first row of the first face, so W is at least 32.
+	const uint32 NumThreadGroupsX = W / ShaderType::kThreadGroupSize;
+	const uint32 NumThreadGroupsY = W / ShaderType::kThreadGroupSize;
+	const uint32 NumThreadGroupsZ = CubeFace_MAX;
+	TShaderMapRef<ShaderType> ComputeShader(GlobalShaderMap);
+	FComputeShaderUtils::AddPass(GraphBuilder, RDG_EVENT_NAME("Decompose"), PassFlags, ComputeShader
+		, Parameters, FIntVector(NumThreadGroupsX, NumThreadGroupsY, NumThreadGroupsZ));
+	// The encoder and the frame copies use the surface outside the graph, and expect it left as a UAV.
+	GraphBuilder.SetTextureAccessFinal(Surface, ERHIAccess::UAVCompute);
 }
 #endif
\ No newline at end of file
@@ -5,11 +5,13 @@
 #include "CoreMinimal.h"
 #include "RHI.h"
 #include "EncodePipelineInterface.h"
+#include "EncodeTimings.h"
 #include "UnrealServerSettings.h"
 
 
 #if 1
 class UTextureRenderTargetCube;
+class FRDGBuilder;
 class FTextureRenderTargetResource;
 
 namespace teleport::server
@@ -31,19 +33,36 @@ public:
 	{
 		return &ColorSurfaceTexture;
 	}
+	const FUnrealCasterEncoderSettings& GetSettings() const override
+	{
+		return Settings;
+	}
+	avs::uid GetClientId() const override
+	{
+		return clientId;
+	}
+	bool CopyFrame(IEncodePipeline* Source) override;
+	FEncodeTimings* GetTimings() override
+	{
+		return &Timings;
+	}
 	/* End IEncodePipeline interface */
 
 private:
 	void Initialize_RenderThread(FRHICommandListImmediate& RHICmdList);
 	void Release_RenderThread(FRHICommandListImmediate& RHICmdList);
 	void CullHiddenCubeSegments_RenderThread(FRHICommandListImmediate& RHICmdList, ERHIFeatureLevel::Type FeatureLevel, teleport::server::CameraInfo CameraInfo, int32 FaceSize, uint32 Divisor);
-	void PrepareFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* TargetResource, ERHIFeatureLevel::Type FeatureLevel, FVector CameraPosition, TArray<bool> BlockIntersectionFlags);
-	void EncodeFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FTransform CameraTransform, bool forceIDR);
-
-	template<typename ShaderType>
-	void DispatchProjectCubemapShader(FRHICommandListImmediate& RHICmdList, FTextureRHIRef TextureRHI, FUnorderedAccessViewRHIRef TextureUAVRHI, ERHIFeatureLevel::Type FeatureLevel);
-
-	void DispatchDecomposeCubemapShader(FRHICommandListImmediate& RHICmdList, FTextureRHIRef TextureRHI, FUnorderedAccessViewRHIRef TextureUAVRHI, ERHIFeatureLevel::Type FeatureLevel,FVector CameraPosition, const TArray<bool>& BlockIntersectionFlags);
+	void PrepareFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* TargetResource, ERHIFeatureLevel::Type FeatureLevel, FVector CameraPosition, const TArray<bool>* ChangedBlockIntersectionFlags);
+	void EncodeFrame_RenderThread(FRHICommandListImmediate& RHICmdList, double CaptureTime, FTransform CameraTransform, bool forceIDR);
+	void CopyFrame_RenderThread(FRHICommandListImmediate& RHICmdList, FSurfaceTexture* SourceSurfaceTexture);
+
+	//! Adds the pass that decomposes the cubemap's colour, depth and camera position into the encoder's surface.
+	//! bAllowAsyncCompute is false while the pass is being timed.
+	void AddDecomposeCubemapPass(FRDGBuilder& GraphBuilder, FRHITexture* CubemapRHI, ERHIFeatureLevel::Type FeatureLevel,FVector CameraPosition, FRHIShaderResourceView* BlockCullFlagSRV, uint32 BlocksPerFaceAcross
+		,bool bAllowAsyncCompute);
+	//! Writes the flags into the next buffer of the ring, growing the buffers if needed.
+	void UpdateBlockCullFlags_RenderThread(FRHICommandListImmediate& RHICmdList, const TArray<bool>& BlockIntersectionFlags);
+	void CreateBlockCullFlagBuffers_RenderThread(uint32 NumFlags);
 	
 	struct FShaderFlag
 	{
@@ -54,13 +73,30 @@ private:
 	teleport::server::ClientNetworkContext* ClientNetworkContext;
 
 	FUnrealCasterEncoderSettings Settings;
+	// The encoder's input, which is registered with it once through Client_SetVideoEncodeParams.
+	// Frames are decomposed straight into it: the server takes no surface per frame and gives no fence,
+	// so preparing frames in a ring of surfaces would still need a copy into this one before each encode.
 	FSurfaceTexture ColorSurfaceTexture;
+	// Game thread: when the frame being prepared was captured.
+	double FrameCaptureTime = 0.0;
 	FSurfaceTexture DepthSurfaceTexture;
 
 	FVector2D WorldZToDeviceZTransform;
 
-	FTextureRHIRef				SourceCubemapRHI;
-	FUnorderedAccessViewRHIRef UnorderedAccessViewRHIRef;
+	// The block cull flags persist between frames, and are only uploaded when they change.
+	// They are written round-robin, so a buffer the GPU may still be reading from a previous frame is never overwritten.
+	static constexpr int32 NumBlockCullFlagBuffers = 3;
+	// Enough for 16 blocks per face across, without reallocating.
+	static constexpr uint32 DefaultBlockCullFlagCapacity = 6 * 16 * 16;
+	FBufferRHIRef BlockCullFlagBuffers[NumBlockCullFlagBuffers];
+	FShaderResourceViewRHIRef BlockCullFlagSRVs[NumBlockCullFlagBuffers];
+	uint32 BlockCullFlagCapacity = 0;
+	uint32 NumBlockCullFlags = 0;
+	int32 CurrentBlockCullFlagBuffer = 0;
+	// Game thread: the flags last sent to the render thread.
+	TArray<bool> LastBlockIntersectionFlags;
+
+	FEncodeTimings Timings;
 
 	ATeleportMonitor *Monitor;
 	avs::uid clientId = 0;
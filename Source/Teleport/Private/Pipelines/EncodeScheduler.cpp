@@ -0,0 +1,89 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "Pipelines/EncodeScheduler.h"
+#include "CoreGlobals.h"
+#include "Misc/App.h"
+
+void FEncodeScheduler::AddClient(avs::uid clientId)
+{
+	Clients.FindOrAdd(clientId);
+}
+
+void FEncodeScheduler::RemoveClient(avs::uid clientId)
+{
+	Clients.Remove(clientId);
+}
+
+bool FEncodeScheduler::ShouldEncode(avs::uid clientId, int32 EncodeFrequency, int32 TargetFPS)
+{
+	FClientSchedule* Schedule = Clients.Find(clientId);
+	if (!Schedule)
+	{
+		return true;
+	}
+	// The settings take effect from the next frame that's planned.
+	Schedule->EncodeFrequency = FMath::Max(EncodeFrequency, 1);
+	Schedule->TargetFPS = TargetFPS;
+	// GFrameCounter starts at zero, so offset it to keep zero meaning "never".
+	const uint64 Frame = GFrameCounter + 1;
+	if (Frame != PlannedFrame)
+	{
+		PlanFrame(Frame, FApp::GetCurrentTime(), FApp::GetDeltaTime());
+	}
+	return Schedule->bEncodeThisFrame;
+}
+
+uint64 FEncodeScheduler::GetDeadlineMisses(avs::uid clientId) const
+{
+	const FClientSchedule* Schedule = Clients.Find(clientId);
+	return Schedule ? Schedule->DeadlineMisses : 0;
+}
+
+void FEncodeScheduler::PlanFrame(uint64 Frame, double Now, double DeltaTime)
+{
+	PlannedFrame = Frame;
+	TArray<FClientSchedule*, TInlineAllocator<16>> Due;
+	// The number of encodes per frame that the clients need on average.
+	double EncodesPerFrame = 0.0;
+	for (auto& Client : Clients)
+	{
+		FClientSchedule& Schedule = Client.Value;
+		Schedule.bEncodeThisFrame = false;
+		double Rate = 1.0 / Schedule.EncodeFrequency;
+		bool bDue = !Schedule.LastEncodeFrame || Frame - Schedule.LastEncodeFrame >= (uint64)Schedule.EncodeFrequency;
+		if (Schedule.TargetFPS > 0)
+		{
+			Rate = FMath::Min(Rate, Schedule.TargetFPS * DeltaTime);
+			// Allow half a frame early, or frame time jitter would make us skip a whole frame.
+			bDue &= !Schedule.LastEncodeFrame || Now + 0.5 * DeltaTime >= Schedule.LastEncodeTime + 1.0 / Schedule.TargetFPS;
+		}
+		EncodesPerFrame += Rate;
+		if (bDue)
+		{
+			if (!Schedule.DueFrame)
+			{
+				Schedule.DueFrame = Frame;
+			}
+			Due.Add(&Schedule);
+		}
+	}
+	// Longest-waiting clients first.
+	Due.Sort([](const FClientSchedule& A, const FClientSchedule& B)
+		{
+			return A.DueFrame != B.DueFrame ? A.DueFrame < B.DueFrame : A.LastEncodeFrame < B.LastEncodeFrame;
+		});
+	const int32 MaxEncodes = FMath::Max(FMath::CeilToInt(EncodesPerFrame - KINDA_SMALL_NUMBER), 1);
+	for (int32 i = 0; i < FMath::Min(Due.Num(), MaxEncodes); i++)
+	{
+		FClientSchedule& Schedule = *Due[i];
+		// A client's first frame may be deferred while it's fitted in between the others; that's not a miss.
+		if (Schedule.LastEncodeFrame && Frame > Schedule.DueFrame)
+		{
+			Schedule.DeadlineMisses++;
+		}
+		Schedule.bEncodeThisFrame = true;
+		Schedule.LastEncodeFrame = Frame;
+		Schedule.LastEncodeTime = Now;
+		Schedule.DueFrame = 0;
+	}
+}
@@ -0,0 +1,45 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "libavstream/common_exports.h"
+
+/*! Decides, each frame, which clients capture and encode a video frame.
+
+	Each client encodes at most once every EncodeFrequency frames, and no more often than its TargetFPS.
+	Clients that are due on the same frame are spread over the following frames, so that no more are encoded
+	per frame than the clients' combined rate requires. Once spread, they stay staggered, and the GPU load stays even.
+	A client that is encoded on a later frame than the one it became due on has missed its deadline.
+	Game thread only.
+*/
+class FEncodeScheduler
+{
+public:
+	void AddClient(avs::uid clientId);
+	void RemoveClient(avs::uid clientId);
+	//! True if the client should capture and encode this frame. Call once per frame for each client.
+	//! Clients that were never added are always encoded.
+	bool ShouldEncode(avs::uid clientId, int32 EncodeFrequency, int32 TargetFPS);
+	//! The number of frames encoded for the client later than they were due.
+	uint64 GetDeadlineMisses(avs::uid clientId) const;
+
+private:
+	struct FClientSchedule
+	{
+		int32 EncodeFrequency = 1;
+		int32 TargetFPS = 0;
+		//! The frame and time of the last encode. Frame zero means never encoded.
+		uint64 LastEncodeFrame = 0;
+		double LastEncodeTime = 0.0;
+		//! The frame on which the client became due, or zero if it isn't due.
+		uint64 DueFrame = 0;
+		uint64 DeadlineMisses = 0;
+		bool bEncodeThisFrame = false;
+	};
+	TMap<avs::uid, FClientSchedule> Clients;
+	uint64 PlannedFrame = 0;
+
+	//! Chooses the clients to encode this frame.
+	void PlanFrame(uint64 Frame, double Now, double DeltaTime);
+};
@@ -0,0 +1,202 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "Pipelines/EncodeTimings.h"
+#include "TeleportModule.h"
+#include "HAL/FileManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "RenderGraphBuilder.h"
+
+// Summed over all clients.
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Decompose GPU ms"), STAT_TeleportDecomposeGPUMs, STATGROUP_TeleportEncode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Reflections GPU ms"), STAT_TeleportReflectionsGPUMs, STATGROUP_TeleportEncode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Encode submit ms"), STAT_TeleportEncodeSubmitMs, STATGROUP_TeleportEncode);
+// The most recent client's.
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Capture to submit ms"), STAT_TeleportCaptureToSubmitMs, STATGROUP_TeleportEncode);
+
+CSV_DEFINE_CATEGORY(Teleport, true);
+
+static void WriteLogLine(FArchive& Log, const FString& Line)
+{
+	FTCHARToUTF8 Utf8(*(Line + TEXT("\n")));
+	Log.Serialize((void*)Utf8.Get(), Utf8.Length());
+}
+
+void FEncodeTimings::Initialise_RenderThread(avs::uid InClientId, bool bWriteLog)
+{
+	ClientId = InClientId;
+	EncodedFrames = 0;
+	for (FGPUTimer& Timer : GPUTimers)
+	{
+		Timer.NextQuery = 0;
+		Timer.Ms = 0.0f;
+		for (FTimestampQueries& Queries : Timer.Queries)
+		{
+			Queries.Begin = RHICreateRenderQuery(RQT_AbsoluteTime);
+			Queries.End = RHICreateRenderQuery(RQT_AbsoluteTime);
+			Queries.bPending = false;
+		}
+	}
+	const FString Client = FString::Printf(TEXT("Client%llu"), ClientId);
+	DecomposeCsvStat = FName(*(Client + TEXT("_DecomposeGPU")));
+	ReflectionsCsvStat = FName(*(Client + TEXT("_ReflectionsGPU")));
+	SubmitCsvStat = FName(*(Client + TEXT("_EncodeSubmit")));
+	LatencyCsvStat = FName(*(Client + TEXT("_CaptureToSubmit")));
+
+	Log.Reset();
+	if (bWriteLog)
+	{
+		const FString FileName = FString::Printf(TEXT("EncodeTimings_%llu_%s.csv"), ClientId, *FDateTime::Now().ToString());
+		const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Teleport"), FileName);
+		Log.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+		if (Log)
+		{
+			WriteLogLine(*Log, TEXT("Frame,DecomposeGPUMs,ReflectionsGPUMs,EncodeSubmitMs,CaptureToSubmitMs"));
+		}
+		else
+		{
+			UE_LOG(LogTeleport, Warning, TEXT("Failed to create encode timing log %s"), *FilePath);
+		}
+	}
+}
+
+void FEncodeTimings::Release_RenderThread()
+{
+	for (FGPUTimer& Timer : GPUTimers)
+	{
+		for (FTimestampQueries& Queries : Timer.Queries)
+		{
+			Queries.Begin.SafeRelease();
+			Queries.End.SafeRelease();
+			Queries.bPending = false;
+		}
+	}
+	if (Log)
+	{
+		Log->Close();
+		Log.Reset();
+	}
+}
+
+bool FEncodeTimings::IsTimingGPU() const
+{
+	if (Log)
+	{
+		return true;
+	}
+#if CSV_PROFILER
+	if (FCsvProfiler::Get()->IsCapturing_Renderthread())
+	{
+		return true;
+	}
+#endif
+#if STATS
+	if (FThreadStats::IsCollectingData())
+	{
+		return true;
+	}
+#endif
+	return false;
+}
+
+void FEncodeTimings::BeginGPUWork_RenderThread(EGPUWork Work, FRHIRenderQuery*& OutBegin, FRHIRenderQuery*& OutEnd)
+{
+	ResolveGPUQueries_RenderThread();
+	OutBegin = nullptr;
+	OutEnd = nullptr;
+	if (!IsTimingGPU())
+	{
+		return;
+	}
+	// If the GPU is so far behind that these are still unread, skip timing this frame rather than wait.
+	FGPUTimer& Timer = GPUTimers[int32(Work)];
+	FTimestampQueries& Queries = Timer.Queries[Timer.NextQuery];
+	if (!Queries.Begin || Queries.bPending)
+	{
+		return;
+	}
+	Timer.NextQuery = (Timer.NextQuery + 1) % NumTimestampQueries;
+	// The graph is executed before the next call, so the queries will have been issued by the time they're resolved.
+	Queries.bPending = true;
+	OutBegin = Queries.Begin;
+	OutEnd = Queries.End;
+}
+
+void FEncodeTimings::SkipGPUWork_RenderThread(EGPUWork Work)
+{
+	GPUTimers[int32(Work)].Ms = 0.0f;
+}
+
+void FEncodeTimings::AddTimestampPass(FRDGBuilder& GraphBuilder, FRHIRenderQuery* Query)
+{
+	if (!Query)
+	{
+		return;
+	}
+	GraphBuilder.AddPass(RDG_EVENT_NAME("TeleportTimestamp"), ERDGPassFlags::None | ERDGPassFlags::NeverCull
+		, [Query](FRHICommandListImmediate& RHICmdList)
+	{
+		RHICmdList.EndRenderQuery(Query);
+	});
+}
+
+void FEncodeTimings::ResolveGPUQueries_RenderThread()
+{
+	for (int32 Work = 0; Work < int32(EGPUWork::Num); Work++)
+	{
+		FGPUTimer& Timer = GPUTimers[Work];
+		for (FTimestampQueries& Queries : Timer.Queries)
+		{
+			if (!Queries.bPending)
+			{
+				continue;
+			}
+			// Absolute time queries are in microseconds.
+			uint64 BeginMicroseconds = 0;
+			uint64 EndMicroseconds = 0;
+			if (!RHIGetRenderQueryResult(Queries.Begin, BeginMicroseconds, false) || !RHIGetRenderQueryResult(Queries.End, EndMicroseconds, false))
+			{
+				continue;
+			}
+			Queries.bPending = false;
+			if (EndMicroseconds < BeginMicroseconds)
+			{
+				continue;
+			}
+			Timer.Ms = float(EndMicroseconds - BeginMicroseconds) * 0.001f;
+			if (EGPUWork(Work) == EGPUWork::Decompose)
+			{
+				INC_FLOAT_STAT_BY(STAT_TeleportDecomposeGPUMs, Timer.Ms);
+			}
+			else
+			{
+				INC_FLOAT_STAT_BY(STAT_TeleportReflectionsGPUMs, Timer.Ms);
+			}
+		}
+	}
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(DecomposeCsvStat, CSV_CATEGORY_INDEX(Teleport), GPUTimers[int32(EGPUWork::Decompose)].Ms, ECsvCustomStatOp::Set);
+	FCsvProfiler::RecordCustomStat(ReflectionsCsvStat, CSV_CATEGORY_INDEX(Teleport)
+		, GPUTimers[int32(EGPUWork::UpdateReflections)].Ms + GPUTimers[int32(EGPUWork::WriteReflections)].Ms, ECsvCustomStatOp::Set);
+#endif
+}
+
+void FEncodeTimings::RecordEncode_RenderThread(double SubmitSeconds, double CaptureToSubmitSeconds)
+{
+	const float SubmitMs = float(SubmitSeconds * 1000.0);
+	const float LatencyMs = float(CaptureToSubmitSeconds * 1000.0);
+	INC_FLOAT_STAT_BY(STAT_TeleportEncodeSubmitMs, SubmitMs);
+	SET_FLOAT_STAT(STAT_TeleportCaptureToSubmitMs, LatencyMs);
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(SubmitCsvStat, CSV_CATEGORY_INDEX(Teleport), SubmitMs, ECsvCustomStatOp::Set);
+	FCsvProfiler::RecordCustomStat(LatencyCsvStat, CSV_CATEGORY_INDEX(Teleport), LatencyMs, ECsvCustomStatOp::Set);
+#endif
+	if (Log)
+	{
+		// The GPU times lag by the few frames it takes to read back.
+		const float DecomposeGPUMs = GPUTimers[int32(EGPUWork::Decompose)].Ms;
+		const float ReflectionsGPUMs = GPUTimers[int32(EGPUWork::UpdateReflections)].Ms + GPUTimers[int32(EGPUWork::WriteReflections)].Ms;
+		WriteLogLine(*Log, FString::Printf(TEXT("%llu,%.3f,%.3f,%.3f,%.3f"), EncodedFrames, DecomposeGPUMs, ReflectionsGPUMs, SubmitMs, LatencyMs));
+	}
+	EncodedFrames++;
+}
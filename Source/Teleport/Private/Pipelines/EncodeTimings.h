@@ -0,0 +1,83 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "libavstream/common_exports.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+
+class FRDGBuilder;
+
+DECLARE_STATS_GROUP(TEXT("Teleport_Encode"), STATGROUP_TeleportEncode, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_EXTERN(Teleport);
+
+/*! Per-client timings of one encode pipeline.
+
+	The GPU time of each frame's decompose, and of the reflection updates written into the same frame, is measured
+	with timestamp queries, and read back a few frames later without stalling. Not every RHI supports timestamps on
+	the async compute pipe, so while the GPU is being timed the passes run on the graphics pipe, between a pair of
+	timestamp passes. The CPU time of submitting the frame to the encoder, and the time from the frame's capture to
+	that submission, are measured directly.
+	Every timing goes to the Teleport_Encode stat group, to the CSV profiler under the client's id, and optionally to a
+	per-session log in Saved/Teleport, one line per encoded frame.
+	Render thread only.
+*/
+class FEncodeTimings
+{
+public:
+	//! The GPU work timed for each frame, one render graph each.
+	enum class EGPUWork
+	{
+		Decompose,
+		UpdateReflections,
+		WriteReflections,
+		Num
+	};
+
+	void Initialise_RenderThread(avs::uid InClientId, bool bWriteLog);
+	void Release_RenderThread();
+
+	//! Call before building the graph for the work. Its passes go between a timestamp pass for OutBegin and one for OutEnd,
+	//! on the graphics pipe. Both are null if this frame isn't timed, and then the passes may use async compute.
+	void BeginGPUWork_RenderThread(EGPUWork Work, FRHIRenderQuery*& OutBegin, FRHIRenderQuery*& OutEnd);
+	//! Call instead, on a frame where the work isn't needed, so that it counts as taking no time.
+	void SkipGPUWork_RenderThread(EGPUWork Work);
+	//! Adds a pass that writes the timestamp, if Query isn't null.
+	static void AddTimestampPass(FRDGBuilder& GraphBuilder, FRHIRenderQuery* Query);
+	//! Call once a frame has been given to the encoder.
+	void RecordEncode_RenderThread(double SubmitSeconds, double CaptureToSubmitSeconds);
+
+private:
+	//! True if anything is recording the GPU times.
+	bool IsTimingGPU() const;
+	//! Reads back any queries that have completed, without waiting for the others.
+	void ResolveGPUQueries_RenderThread();
+
+	struct FTimestampQueries
+	{
+		FRenderQueryRHIRef Begin;
+		FRenderQueryRHIRef End;
+		bool bPending = false;
+	};
+	// Enough frames in flight that a result is almost always ready before its queries are needed again.
+	static constexpr int32 NumTimestampQueries = 4;
+	struct FGPUTimer
+	{
+		FTimestampQueries Queries[NumTimestampQueries];
+		int32 NextQuery = 0;
+		//! The most recent result.
+		float Ms = 0.0f;
+	};
+	FGPUTimer GPUTimers[int32(EGPUWork::Num)];
+
+	avs::uid ClientId = 0;
+	uint64 EncodedFrames = 0;
+
+	FName DecomposeCsvStat;
+	FName ReflectionsCsvStat;
+	FName SubmitCsvStat;
+	FName LatencyCsvStat;
+	TUniquePtr<FArchive> Log;
+};
@@ -98,7 +98,56 @@ private:
 //                            ShaderType                            ShaderPath                     Shader function name    Type
 IMPLEMENT_GLOBAL_SHADER(FResolveLightmapComputeShader, "/Plugin/Teleport/Private/ResolveLightmap.usf", "ResolveLightmapCS", SF_Compute);
 
+// Adds the resolve and copy passes for one lightmap, returning the target, or nullptr if the shader is unavailable.
+static FRDGTextureRef AddResolveLightmapPasses(FRDGBuilder &GraphBuilder,const FResolveLightmapComputeShaderDispatchParams &Params)
+{
+	typename FResolveLightmapComputeShader::FPermutationDomain PermutationVector;
+	
+	// Add any static permutation options here
+	// PermutationVector.Set<FResolveLightmapComputeShader::FMyPermutationName>(12345);
+
+	TShaderMapRef<FResolveLightmapComputeShader> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	if (!ComputeShader.IsValid()) {
+		UE_LOG(LogTeleport,Error,TEXT("The compute shader has a problem)."));
+		// We exit here as we don't want to crash the game if the shader is not found or has an error.
+		return nullptr;
+	}
+	FResolveLightmapComputeShader::FParameters* PassParameters = GraphBuilder.AllocParameters<FResolveLightmapComputeShader::FParameters>();
+
+	FRDGTextureRef TargetTexture = RegisterExternalTexture(GraphBuilder, Params.TargetTexture->TextureRHI, TEXT("ResolveLightmapComputeShader_RT"));
+	auto Fmt=TargetTexture->Desc.Format;
+	FRDGTextureDesc Desc=FRDGTextureDesc::Create2D({(int)Params.TargetTexture->GetSizeX(),(int)Params.TargetTexture->GetSizeY()},Fmt, FClearValueBinding::White, TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV);
+	FRDGTextureRef TmpTexture = GraphBuilder.CreateTexture(Desc, TEXT("ResolveLightmapComputeShader_TempTexture"));
+	PassParameters->RenderTarget = GraphBuilder.CreateUAV(TmpTexture);
+	PassParameters->SourceLightmap=Params.SourceTexture->TextureRHI;
+	PassParameters->LightMapScale=Params.LightMapScale;
+	PassParameters->LightMapAdd=Params.LightMapAdd;
+
+	auto GroupCount = FComputeShaderUtils::GetGroupCount(FIntVector(Params.X, Params.Y, Params.Z), FIntVector(NUM_THREADS_ResolveLightmapComputeShader_X,NUM_THREADS_ResolveLightmapComputeShader_Y,1));
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("ExecuteResolveLightmapComputeShader"),
+		PassParameters,
+		ERDGPassFlags::AsyncCompute,
+		[PassParameters, ComputeShader, GroupCount](FRHIComputeCommandList& RHICmdList)
+	{
+		FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *PassParameters, GroupCount);
+	});
+
+	// The copy will fail if we don't have matching formats, let's check and make sure we do.
+	if (TargetTexture->Desc.Format ==Fmt) {
+		AddCopyTexturePass(GraphBuilder, TmpTexture, TargetTexture, FRHICopyTextureInfo());
+	} else {
+		UE_LOG(LogTeleport,Error,TEXT("The provided render target has an incompatible format (Please change the RT format)."));
+	}
+	return TargetTexture;
+}
+
 void FResolveLightmapComputeShaderInterface::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, FResolveLightmapComputeShaderDispatchParams Params) {
+	DispatchRenderThread(RHICmdList,MakeArrayView(&Params,1),TArrayView<FRHIGPUTextureReadback*>());
+}
+
+void FResolveLightmapComputeShaderInterface::DispatchRenderThread(FRHICommandListImmediate& RHICmdList,TArrayView<const FResolveLightmapComputeShaderDispatchParams> Params,TArrayView<FRHIGPUTextureReadback*> Readbacks) {
 	FRDGBuilder GraphBuilder(RHICmdList);
 
 	{
@@ -106,55 +155,18 @@ void FResolveLightmapComputeShaderInterface::DispatchRenderThread(FRHICommandLis
 		DECLARE_GPU_STAT(ResolveLightmapComputeShader)
 		RDG_EVENT_SCOPE(GraphBuilder, "ResolveLightmapComputeShader");
 		RDG_GPU_STAT_SCOPE(GraphBuilder, ResolveLightmapComputeShader);
-		
-		typename FResolveLightmapComputeShader::FPermutationDomain PermutationVector;
-		
-		// Add any static permutation options here
-		// PermutationVector.Set<FResolveLightmapComputeShader::FMyPermutationName>(12345);
-
-		TShaderMapRef<FResolveLightmapComputeShader> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
-		
 
-		bool bIsShaderValid = ComputeShader.IsValid();
-
-		if (bIsShaderValid) {
-			FResolveLightmapComputeShader::FParameters* PassParameters = GraphBuilder.AllocParameters<FResolveLightmapComputeShader::FParameters>();
-
-			FRDGTextureRef TargetTexture = RegisterExternalTexture(GraphBuilder, Params.TargetTexture->TextureRHI, TEXT("ResolveLightmapComputeShader_RT"));
-			auto Fmt=TargetTexture->Desc.Format;
-			FRDGTextureDesc Desc=FRDGTextureDesc::Create2D({(int)Params.TargetTexture->GetSizeX(),(int)Params.TargetTexture->GetSizeY()},Fmt, FClearValueBinding::White, TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV);
-			FRDGTextureRef TmpTexture = GraphBuilder.CreateTexture(Desc, TEXT("ResolveLightmapComputeShader_TempTexture"));
-			PassParameters->RenderTarget = GraphBuilder.CreateUAV(TmpTexture);
-			FRDGTextureRef SourceTexture=RegisterExternalTexture(GraphBuilder,Params.SourceTexture->TextureRHI,TEXT("ResolveLightmapComputeShader_Source"));
-			FRDGTextureSRVDesc SrcDesc(SourceTexture);
-			PassParameters->SourceLightmap=Params.SourceTexture->TextureRHI;//GraphBuilder.CreateSRV(SrcDesc);
-			PassParameters->LightMapScale=Params.LightMapScale;
-			PassParameters->LightMapAdd=Params.LightMapAdd;
-
-			auto GroupCount = FComputeShaderUtils::GetGroupCount(FIntVector(Params.X, Params.Y, Params.Z), FIntVector(NUM_THREADS_ResolveLightmapComputeShader_X,NUM_THREADS_ResolveLightmapComputeShader_Y,1));
-			GraphBuilder.AddPass(
-				RDG_EVENT_NAME("ExecuteResolveLightmapComputeShader"),
-				PassParameters,
-				ERDGPassFlags::AsyncCompute,
-				[&PassParameters, ComputeShader, GroupCount](FRHIComputeCommandList& RHICmdList)
-			{
-				FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *PassParameters, GroupCount);
-			});
-
-			
-			// The copy will fail if we don't have matching formats, let's check and make sure we do.
-			if (TargetTexture->Desc.Format ==Fmt) {
-				AddCopyTexturePass(GraphBuilder, TmpTexture, TargetTexture, FRHICopyTextureInfo());
-			} else {
-				UE_LOG(LogTeleport,Error,TEXT("The provided render target has an incompatible format (Please change the RT format)."));
-			}
-			
-		} else {
-			UE_LOG(LogTeleport,Error,TEXT("The compute shader has a problem)."));
-			// We exit here as we don't want to crash the game if the shader is not found or has an error.
-			
+		for(int i=0;i<Params.Num();i++)
+		{
+			FRDGTextureRef TargetTexture=AddResolveLightmapPasses(GraphBuilder,Params[i]);
+			if(i>=Readbacks.Num()||!Readbacks[i])
+				continue;
+			if(TargetTexture)
+				AddEnqueueCopyPass(GraphBuilder,Readbacks[i],TargetTexture);
+			else
+				Readbacks[i]=nullptr;
 		}
 	}
 
 	GraphBuilder.Execute();
-}
\ No newline at end of file
+}
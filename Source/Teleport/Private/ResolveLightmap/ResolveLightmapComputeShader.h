@@ -30,6 +30,8 @@
 
 #include "ResolveLightmapComputeShader.generated.h"
 
+class FRHIGPUTextureReadback;
+
 #define NUM_THREADS_ResolveLightmapComputeShader_X 32
 #define NUM_THREADS_ResolveLightmapComputeShader_Y 32
 #define NUM_THREADS_ResolveLightmapComputeShader_Z 1
@@ -58,6 +60,14 @@ public:
 		FResolveLightmapComputeShaderDispatchParams Params
 	);
 
+	// Resolves many lightmaps in a single graph, one dispatch each. Where Readbacks has a non-null entry, that target is also copied back to the CPU.
+	// If a lightmap can't be resolved, its Readbacks entry is set to null, as no copy will arrive in it.
+	static void DispatchRenderThread(
+		FRHICommandListImmediate& RHICmdList,
+		TArrayView<const FResolveLightmapComputeShaderDispatchParams> Params,
+		TArrayView<FRHIGPUTextureReadback*> Readbacks
+	);
+
 	// Executes this shader on the render thread from the game thread via EnqueueRenderThreadCommand
 	static void DispatchGameThread(
 		FResolveLightmapComputeShaderDispatchParams Params
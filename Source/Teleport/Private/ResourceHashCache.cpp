@@ -0,0 +1,159 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "ResourceHashCache.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "TeleportModule.h"
+
+namespace
+{
+	// Bump this whenever extraction changes in a way that invalidates previously stored resources.
+	const TCHAR *ResourceHashCacheHeader=TEXT("TeleportResourceHashes 2");
+	const TCHAR *ResourceHashCacheFilename=TEXT("resource_hashes.txt");
+}
+
+uint64 FResourceHashCache::Combine(uint64 hash,const void *data,size_t size)
+{
+	return CityHash64WithSeed(static_cast<const char*>(data),size,hash);
+}
+
+void FResourceHashCache::SetCachePath(const FString &cachePath)
+{
+	FString newFilePath=FPaths::Combine(cachePath,ResourceHashCacheFilename);
+	if(newFilePath==FilePath)
+		return;
+	Save();
+	Records.Empty();
+	Dependents.Empty();
+	bDirty=false;
+	FilePath=newFilePath;
+	Load();
+}
+
+bool FResourceHashCache::IsUpToDate(const FString &resourcePath,uint64 hash,uint64 uid) const
+{
+	const Record *r=Records.Find(resourcePath);
+	return r&&r->Hash!=0&&r->Hash==hash&&r->Uid==uid;
+}
+
+void FResourceHashCache::SetHash(const FString &resourcePath,uint64 hash,uint64 uid,const TArray<FString> &dependencies)
+{
+	Record *r=Records.Find(resourcePath);
+	if(r)
+	{
+		if(r->Hash==hash&&r->Uid==uid&&r->Dependencies==dependencies)
+			return;
+		// Whatever was built from the old version of this resource is now out of date.
+		if(r->Hash!=hash)
+			Invalidate(resourcePath);
+		RemoveDependencies(resourcePath,r->Dependencies);
+	}
+	Record &record=Records.FindOrAdd(resourcePath);
+	record.Hash=hash;
+	record.Uid=uid;
+	record.Dependencies=dependencies;
+	AddDependencies(resourcePath,dependencies);
+	bDirty=true;
+}
+
+void FResourceHashCache::Invalidate(const FString &resourcePath)
+{
+	TArray<FString> stack;
+	TSet<FString> visited;
+	stack.Push(resourcePath);
+	while(stack.Num())
+	{
+		FString p=stack.Pop();
+		if(visited.Contains(p))
+			continue;
+		visited.Add(p);
+		Record *r=Records.Find(p);
+		if(r&&r->Hash!=0)
+		{
+			r->Hash=0;
+			bDirty=true;
+		}
+		if(const TSet<FString> *d=Dependents.Find(p))
+		{
+			for(const FString &dependent:*d)
+				stack.Push(dependent);
+		}
+	}
+}
+
+void FResourceHashCache::Clear()
+{
+	Records.Empty();
+	Dependents.Empty();
+	bDirty=true;
+}
+
+void FResourceHashCache::AddDependencies(const FString &resourcePath,const TArray<FString> &dependencies)
+{
+	for(const FString &d:dependencies)
+		Dependents.FindOrAdd(d).Add(resourcePath);
+}
+
+void FResourceHashCache::RemoveDependencies(const FString &resourcePath,const TArray<FString> &dependencies)
+{
+	for(const FString &d:dependencies)
+	{
+		TSet<FString> *s=Dependents.Find(d);
+		if(!s)
+			continue;
+		s->Remove(resourcePath);
+		if(!s->Num())
+			Dependents.Remove(d);
+	}
+}
+
+// One line per resource: hash, uid, path, then the paths it depends on, separated by tabs.
+void FResourceHashCache::Load()
+{
+	TArray<FString> lines;
+	if(!FFileHelper::LoadFileToStringArray(lines,*FilePath))
+		return;
+	if(!lines.Num()||lines[0]!=ResourceHashCacheHeader)
+	{
+		UE_LOG(LogTeleport,Log,TEXT("Ignoring out-of-date resource hashes in %s."),*FilePath);
+		return;
+	}
+	for(int i=1;i<lines.Num();i++)
+	{
+		TArray<FString> fields;
+		lines[i].ParseIntoArray(fields,TEXT("\t"),false);
+		if(fields.Num()<3||fields[2].IsEmpty())
+			continue;
+		Record &record=Records.FindOrAdd(fields[2]);
+		record.Hash=FCString::Strtoui64(*fields[0],nullptr,16);
+		record.Uid=FCString::Strtoui64(*fields[1],nullptr,10);
+		for(int j=3;j<fields.Num();j++)
+			record.Dependencies.Add(fields[j]);
+		AddDependencies(fields[2],record.Dependencies);
+	}
+}
+
+void FResourceHashCache::Save()
+{
+	if(!bDirty||FilePath.IsEmpty())
+		return;
+	TArray<FString> lines;
+	lines.Reserve(Records.Num()+1);
+	lines.Add(ResourceHashCacheHeader);
+	for(const auto &r:Records)
+	{
+		// Invalidated records are kept, so that dependencies are remembered, but never match.
+		FString line=FString::Printf(TEXT("%016llx\t%llu\t%s"),r.Value.Hash,r.Value.Uid,*r.Key);
+		for(const FString &d:r.Value.Dependencies)
+		{
+			line+=TEXT("\t");
+			line+=d;
+		}
+		lines.Add(MoveTemp(line));
+	}
+	if(FFileHelper::SaveStringArrayToFile(lines,*FilePath))
+		bDirty=false;
+	else
+		UE_LOG(LogTeleport,Warning,TEXT("Failed to save resource hashes to %s."),*FilePath);
+}
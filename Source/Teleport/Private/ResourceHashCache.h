@@ -0,0 +1,57 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*! Remembers the content hash each resource had when it was last stored, and which other resources it depends on.
+
+	The records are saved in the cache directory, next to the stored resources, so that an unchanged
+	mesh, material or texture is not extracted again in a later session. When a resource's hash changes,
+	everything that depends on it, directly or indirectly, is invalidated too.
+	The server can only be asked whether it holds a texture, so each record also keeps the uid the server gave the
+	resource. A store that has lost the resource, e.g. because it was cleared, gives its path a new uid, and the
+	record no longer matches.
+	Game thread only.
+*/
+class FResourceHashCache
+{
+public:
+	//! Loads the records from the given cache directory, if it differs from the current one. Unsaved changes are saved first.
+	void SetCachePath(const FString &cachePath);
+	//! True if the resource was stored with this hash and uid, and nothing it depends on has changed since.
+	//! uid is the one the server has for the resource now.
+	bool IsUpToDate(const FString &resourcePath,uint64 hash,uint64 uid) const;
+	//! Records the hash and uid the resource was stored with, and the resources it depends on.
+	void SetHash(const FString &resourcePath,uint64 hash,uint64 uid,const TArray<FString> &dependencies=TArray<FString>());
+	//! Forget the resource's hash, and those of all resources that depend on it.
+	void Invalidate(const FString &resourcePath);
+	//! Forget every record, e.g. because the stored resources have been deleted.
+	void Clear();
+	//! Writes the records to the cache directory if anything changed since the last save.
+	void Save();
+
+	//! Chains the hash of a block of memory onto an existing hash.
+	static uint64 Combine(uint64 hash,const void *data,size_t size);
+	template<typename T> static uint64 Combine(uint64 hash,const T &value)
+	{
+		return Combine(hash,&value,sizeof(T));
+	}
+
+private:
+	struct Record
+	{
+		uint64 Hash=0;
+		uint64 Uid=0;
+		TArray<FString> Dependencies;
+	};
+	TMap<FString,Record> Records;
+	//! Reverse edges of the dependency graph: the resources that depend on each key.
+	TMap<FString,TSet<FString>> Dependents;
+	FString FilePath;
+	bool bDirty=false;
+
+	void Load();
+	void AddDependencies(const FString &resourcePath,const TArray<FString> &dependencies);
+	void RemoveDependencies(const FString &resourcePath,const TArray<FString> &dependencies);
+};
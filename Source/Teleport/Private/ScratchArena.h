@@ -0,0 +1,104 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <type_traits>
+
+/*! A linear allocator for temporary buffers that all share one lifetime, e.g. the converted
+	vertex streams of a single mesh extraction. Nothing is freed individually: Reset() releases
+	everything at once, but keeps the memory, up to a limit, so that a recycled arena doesn't need to allocate again.
+*/
+class FScratchArena
+{
+public:
+	FScratchArena()=default;
+	FScratchArena(const FScratchArena&)=delete;
+	FScratchArena &operator=(const FScratchArena&)=delete;
+	~FScratchArena()
+	{
+		for(Block &b:Blocks)
+			FMemory::Free(b.Data);
+	}
+
+	//! Allocate count default-constructed objects. They are never destroyed, so T must be trivially destructible.
+	template<typename T> T *Alloc(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value,"FScratchArena does not call destructors.");
+		if(!count)
+			return nullptr;
+		T *ptr=static_cast<T*>(AllocBytes(count*sizeof(T),alignof(T)));
+		std::uninitialized_default_construct_n(ptr,count);
+		return ptr;
+	}
+
+	//! Release all allocations. If the memory was spread over several blocks, it's merged into one for next time.
+	//! If more than maxCapacity bytes are held, they're freed instead, so that one unusually large use doesn't keep its memory.
+	void Reset(size_t maxCapacity=SIZE_MAX)
+	{
+		if(GetCapacity()>maxCapacity)
+		{
+			for(Block &b:Blocks)
+				FMemory::Free(b.Data);
+			Blocks.Reset();
+			return;
+		}
+		if(Blocks.Num()>1)
+		{
+			size_t total=GetCapacity();
+			for(Block &b:Blocks)
+				FMemory::Free(b.Data);
+			Blocks.Reset();
+			AddBlock(total);
+		}
+		for(Block &b:Blocks)
+			b.Used=0;
+	}
+
+	//! The total memory held, in bytes.
+	size_t GetCapacity() const
+	{
+		size_t total=0;
+		for(const Block &b:Blocks)
+			total+=b.Size;
+		return total;
+	}
+
+private:
+	struct Block
+	{
+		uint8 *Data=nullptr;
+		size_t Size=0;
+		size_t Used=0;
+	};
+	TArray<Block> Blocks;
+	static constexpr size_t MinBlockSize=1<<20;
+	static constexpr size_t BlockAlignment=16;
+
+	void AddBlock(size_t size)
+	{
+		Block &b=Blocks.AddDefaulted_GetRef();
+		b.Size=FMath::Max(size,MinBlockSize);
+		b.Data=static_cast<uint8*>(FMemory::Malloc(b.Size,BlockAlignment));
+	}
+
+	void *AllocBytes(size_t bytes,size_t alignment)
+	{
+		alignment=FMath::Max(alignment,BlockAlignment);
+		if(Blocks.Num())
+		{
+			Block &b=Blocks.Last();
+			size_t start=Align(b.Used,alignment);
+			if(start+bytes<=b.Size)
+			{
+				b.Used=start+bytes;
+				return b.Data+start;
+			}
+		}
+		AddBlock(bytes);
+		Block &b=Blocks.Last();
+		b.Used=bytes;
+		return b.Data;
+	}
+};
@@ -0,0 +1,109 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "StreamableSpatialIndex.h"
+#include "Components/StreamableRootComponent.h"
+#include "GameFramework/Actor.h"
+
+// Bounds that have moved by less than this, in cm, are left where they are in the octree.
+static constexpr float BoundsTolerance = 1.0f;
+
+FStreamableSpatialIndex::FStreamableSpatialIndex()
+	: Octree(FVector::ZeroVector, HALF_WORLD_MAX)
+{
+}
+
+FBox FStreamableSpatialIndex::GetBounds(const UStreamableRootComponent* Root)
+{
+	const AActor* Actor = Root->GetOwner();
+	if (!Actor)
+	{
+		return FBox(ForceInit);
+	}
+	FBox Bounds = Actor->GetComponentsBoundingBox(true);
+	// An actor with nothing visible, such as a light, is streamed when its position is in range.
+	if (!Bounds.IsValid)
+	{
+		const FVector Location = Actor->GetActorLocation();
+		Bounds = FBox(Location, Location);
+	}
+	return Bounds;
+}
+
+void FStreamableSpatialIndex::Add(UStreamableRootComponent* Root)
+{
+	if (!Root || ElementIds.Contains(Root))
+	{
+		return;
+	}
+	Octree.AddElement(FElement{ Root, GetBounds(Root), this });
+	Version++;
+}
+
+void FStreamableSpatialIndex::Remove(UStreamableRootComponent* Root)
+{
+	MovedRoots.Remove(Root);
+	FOctreeElementId2 Id;
+	if (!ElementIds.RemoveAndCopyValue(Root, Id))
+	{
+		return;
+	}
+	Octree.RemoveElement(Id);
+	Version++;
+}
+
+void FStreamableSpatialIndex::MarkMoved(UStreamableRootComponent* Root)
+{
+	if (ElementIds.Contains(Root))
+	{
+		MovedRoots.Add(Root);
+	}
+}
+
+void FStreamableSpatialIndex::UpdateMoved()
+{
+	for (UStreamableRootComponent* Root : MovedRoots)
+	{
+		Update(Root);
+	}
+	MovedRoots.Reset();
+}
+
+void FStreamableSpatialIndex::Update(UStreamableRootComponent* Root)
+{
+	const FOctreeElementId2* Id = ElementIds.Find(Root);
+	if (!Id)
+	{
+		return;
+	}
+	const FBox Bounds = GetBounds(Root);
+	if (Octree.GetElementById(*Id).Bounds.Equals(Bounds, BoundsTolerance))
+	{
+		return;
+	}
+	Octree.RemoveElement(*Id);
+	ElementIds.Remove(Root);
+	Octree.AddElement(FElement{ Root, Bounds, this });
+	Version++;
+}
+
+void FStreamableSpatialIndex::FindWithinRadius(const FVector& Location, float Radius, TArray<UStreamableRootComponent*>& OutRoots) const
+{
+	const float RadiusSquared = Radius * Radius;
+	Octree.FindElementsWithBoundsTest(FBoxCenterAndExtent(Location, FVector(Radius)), [&](const FElement& Element)
+	{
+		if (Element.Bounds.ComputeSquaredDistanceToPoint(Location) <= RadiusSquared)
+		{
+			OutRoots.Add(Element.Root);
+		}
+	});
+}
+
+bool FStreamableSpatialIndex::IsWithinRadius(const UStreamableRootComponent* Root, const FVector& Location, float Radius) const
+{
+	const FOctreeElementId2* Id = ElementIds.Find(Root);
+	if (!Id)
+	{
+		return false;
+	}
+	return Octree.GetElementById(*Id).Bounds.ComputeSquaredDistanceToPoint(Location) <= Radius * Radius;
+}
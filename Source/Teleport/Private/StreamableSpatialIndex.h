@@ -0,0 +1,79 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/GenericOctree.h"
+
+class UStreamableRootComponent;
+
+/*! A loose octree over the bounds of every streamable actor in a world.
+
+	Sessions query it by their client's position to decide what to stream, instead of relying on physics overlaps.
+	Stationary actors are added once. Movable ones report when they move, and are moved in the octree together,
+	once per frame, so an actor that doesn't move costs nothing.
+	Game thread only.
+*/
+class FStreamableSpatialIndex
+{
+public:
+	FStreamableSpatialIndex();
+
+	void Add(UStreamableRootComponent* Root);
+	void Remove(UStreamableRootComponent* Root);
+	//! The root's actor has moved, so its bounds should be updated.
+	void MarkMoved(UStreamableRootComponent* Root);
+	//! Moves the roots marked since the last call, where their bounds have changed. Call once per frame.
+	void UpdateMoved();
+
+	//! Adds to OutRoots every root whose bounds are within Radius of Location.
+	void FindWithinRadius(const FVector& Location, float Radius, TArray<UStreamableRootComponent*>& OutRoots) const;
+	//! False if the root isn't in the index.
+	bool IsWithinRadius(const UStreamableRootComponent* Root, const FVector& Location, float Radius) const;
+	//! Changes whenever a root is added, removed or moved.
+	uint32 GetVersion() const
+	{
+		return Version;
+	}
+
+private:
+	struct FElement
+	{
+		UStreamableRootComponent* Root = nullptr;
+		FBox Bounds;
+		FStreamableSpatialIndex* Index = nullptr;
+	};
+	struct FElementSemantics
+	{
+		enum { MaxElementsPerLeaf = 16 };
+		enum { MinInclusiveElementsPerNode = 7 };
+		enum { MaxNodeDepth = 12 };
+		typedef TInlineAllocator<MaxElementsPerLeaf> ElementAllocator;
+
+		FORCEINLINE static FBoxCenterAndExtent GetBoundingBox(const FElement& Element)
+		{
+			return FBoxCenterAndExtent(Element.Bounds);
+		}
+		FORCEINLINE static bool AreElementsEqual(const FElement& A, const FElement& B)
+		{
+			return A.Root == B.Root;
+		}
+		FORCEINLINE static void SetElementId(const FElement& Element, FOctreeElementId2 Id)
+		{
+			Element.Index->ElementIds.Add(Element.Root, Id);
+		}
+		FORCEINLINE static void ApplyOffset(FElement& Element, const FVector& Offset)
+		{
+			Element.Bounds = Element.Bounds.ShiftBy(Offset);
+		}
+	};
+
+	static FBox GetBounds(const UStreamableRootComponent* Root);
+	//! Moves the root if its bounds have changed.
+	void Update(UStreamableRootComponent* Root);
+
+	TOctree2<FElement, FElementSemantics> Octree;
+	TMap<const UStreamableRootComponent*, FOctreeElementId2> ElementIds;
+	TSet<UStreamableRootComponent*> MovedRoots;
+	uint32 Version = 0;
+};
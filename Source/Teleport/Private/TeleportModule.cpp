@@ -3,6 +3,7 @@
 #include "TeleportModule.h"
 #include "Interfaces/IPluginManager.h"
 #include "GeometrySource.h"
+#include "Components/ReflectionLightBuffer.h"
 #include "Misc/Paths.h"
 #include "ShaderCore.h"
 #include "TeleportServer/Exports.h"
@@ -20,10 +21,13 @@ void FTeleportModule::StartupModule()
 	TSharedPtr<IPlugin> TeleportPlugin=IPluginManager::Get().FindPlugin(TEXT("Teleport"));
 	const FString PluginShaderDir = FPaths::Combine(TeleportPlugin->GetBaseDir(), TEXT("Shaders"));
 	AddShaderSourceDirectoryMapping(TEXT("/Plugin/Teleport"), PluginShaderDir);
+	FReflectionLightBuffer::Startup();
 }
 
 void FTeleportModule::ShutdownModule()
 {
+	geometrySource.CancelTextureCompression(true);
+	FReflectionLightBuffer::Shutdown();
 	teleport::server::SetOutputLogCallback(nullptr);
 }
 
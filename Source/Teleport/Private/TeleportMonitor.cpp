@@ -10,11 +10,13 @@
 #include "Engine/TextureRenderTarget.h"
 #include "Engine/World.h"
 #include "Kismet/GameplayStatics.h"
+#include "UObject/UObjectIterator.h"
 #include "TeleportModule.h"
 #include "Teleport.h"
 
 #include "Components/SessionComponent.h"
 #include "Components/StreamableNode.h"
+#include "Components/StreamableRootComponent.h"
 #include "GeometrySource.h"
 #include "Teleport.h"
 #include "TeleportServer/ServerSettings.h"
@@ -36,6 +38,9 @@ ATeleportMonitor::ATeleportMonitor(const class FObjectInitializer &ObjectInitial
 	PrimaryActorTick.TickGroup = TG_PrePhysics;
 
 	RequiredLatencyMs = 30;
+	MovementPositionThreshold = 0.1f;
+	MovementRotationThreshold = 0.1f;
+	MaxMovementUpdatesPerFrame = 1024;
 	// Defaults from settings class.
 	const UTeleportSettings *TeleportSettings = GetDefault<UTeleportSettings>();
 	if (TeleportSettings)
@@ -53,6 +58,10 @@ ATeleportMonitor::ATeleportMonitor(const class FObjectInitializer &ObjectInitial
 	bDeferOutput = false;
 	bDoCubemapCulling = false;
 	BlocksPerCubeFaceAcross = 2;
+	CubemapCullingMargin = 10.0f;
+	bShareCaptures = false;
+	CaptureSharingDistance = 5.0f;
+	bLogEncodeTimings = false;
 	TargetFPS = 60;
 	CullQuadIndex = -1;
 	IDRInterval = 0; // Value of 0 means only first frame will be IDR
@@ -93,21 +102,26 @@ ATeleportMonitor::~ATeleportMonitor()
 		Monitors.FindAndRemoveChecked(world);
 }
 
-ATeleportMonitor *ATeleportMonitor::Instantiate(UWorld *world)
+ATeleportMonitor *ATeleportMonitor::Find(UWorld *world)
 {
 	auto i = Monitors.Find(world);
 	if (i)
 	{
 		return *i;
 	}
-	ATeleportMonitor *M = nullptr;
 	TArray<AActor *> MActors;
 	UGameplayStatics::GetAllActorsOfClass(world, ATeleportMonitor::StaticClass(), MActors);
 	if (MActors.Num() > 0)
 	{
-		M = static_cast<ATeleportMonitor *>(MActors[0]);
+		return static_cast<ATeleportMonitor *>(MActors[0]);
 	}
-	else
+	return nullptr;
+}
+
+ATeleportMonitor *ATeleportMonitor::Instantiate(UWorld *world)
+{
+	ATeleportMonitor *M = Find(world);
+	if (!M)
 	{
 		UClass *monitorClass = ATeleportMonitor::StaticClass();
 		M = world->SpawnActor<ATeleportMonitor>(monitorClass, FVector(0.0f, 0.f, 0.f), FRotator(0.0f, 0.f, 0.f), FActorSpawnParameters());
@@ -148,8 +162,19 @@ void ATeleportMonitor::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Any texture compression from the editor is stopped before the server starts.
+	ITeleport::Get().GetGeometrySource()->SetPlaying(true);
 	ServerID = GenerateServerUid();
 
+	// Streamable actors that began play before this monitor existed couldn't add themselves to its index.
+	for (TObjectIterator<UStreamableRootComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == GetWorld() && It->HasBegunPlay())
+		{
+			It->AddToMonitor(this);
+		}
+	}
+
 	// Decompose the geometry in the level, if we are streaming the geometry.
 	if (teleport::server::GetServerSettings().enableGeometryStreaming)
 	{
@@ -184,6 +209,7 @@ void ATeleportMonitor::BeginPlay()
 void ATeleportMonitor::EndPlay(const EEndPlayReason::Type reason)
 {
 	Server_Teleport_Shutdown();
+	ITeleport::Get().GetGeometrySource()->SetPlaying(false);
 	Super::EndPlay(reason);
 }
 
@@ -457,6 +483,8 @@ void ATeleportMonitor::CheckForNewClients()
 
 void ATeleportMonitor::Tick(float DeltaTS)
 {
+	StreamableIndex.UpdateMoved();
+	ITeleport::Get().GetGeometrySource()->SendNodeTransforms();
 	Server_Tick(DeltaTS);
 	CheckForNewClients();
 }
@@ -506,6 +534,7 @@ void ATeleportMonitor::InitialiseGeometrySource()
 		}
 	}
 #endif
-	geometrySource->CompressTextures();
+	// The background task was stopped when play began; finish its queue before the server starts streaming.
+	geometrySource->CompressRemainingTextures();
 }
 #endif
\ No newline at end of file
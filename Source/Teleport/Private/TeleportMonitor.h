@@ -7,6 +7,8 @@
 #include "GameFramework/Actor.h"
 
 #include "TeleportSettings.h"
+#include "Pipelines/EncodeScheduler.h"
+#include "StreamableSpatialIndex.h"
 
 #include "Windows/AllowWindowsPlatformAtomics.h"
 #include "Windows/PreWindowsApi.h"
@@ -57,6 +59,8 @@ public:
 
 	/// Create or get the singleton instance of TeleportMonitor for the given UWorld.
 	static ATeleportMonitor* Instantiate(UWorld* world);
+	/// Get the world's TeleportMonitor if it has one, without creating it.
+	static ATeleportMonitor* Find(UWorld* world);
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SRT)
 	int32 RequiredLatencyMs;
@@ -71,9 +75,11 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Teleport)
 	int32 MinimumPriority;
 
+	// Streamable actors whose bounds come within this distance of a client, in cm, are streamed to it.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Teleport)
 	int32 DetectionSphereRadius;
 
+	// Streamed actors are unstreamed once their bounds are this much further than DetectionSphereRadius from the client.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Teleport)
 	int32 DetectionSphereBufferDistance;
 
@@ -100,6 +106,18 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.5", ClampMax = "300.0"))
 	float ConfirmationWaitTime;
 
+	// A moving node's transform is only sent once it's this far, in cm, from the position last sent.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.0"))
+	float MovementPositionThreshold;
+
+	// A rotating node's transform is only sent once it's turned this many degrees from the rotation last sent.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0.0"))
+	float MovementRotationThreshold;
+
+	// The most node transforms sent per frame; those that have moved furthest go first. Zero for no limit.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Geometry, meta = (ClampMin = "0"))
+	int32 MaxMovementUpdatesPerFrame;
+
 	// Determines if video will be encoded and streamed
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding)
 	bool bStreamVideo;
@@ -123,6 +141,22 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding)
 	int32 BlocksPerCubeFaceAcross;
 
+	// Degrees added to each side of the client's field of view when culling, to allow for the client turning before the frame arrives.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding, meta = (ClampMin = "0.0", ClampMax = "45.0"))
+	float CubemapCullingMargin;
+
+	// Clients whose captures are within CaptureSharingDistance of each other share one cubemap render, decompose and reflection update.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding)
+	bool bShareCaptures;
+
+	// The greatest distance, in cm, between capture positions that can share a cubemap.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding, meta = (ClampMin = "0.0", EditCondition = "bShareCaptures"))
+	float CaptureSharingDistance;
+
+	// Write each client's encode timings to a log in Saved/Teleport, one line per frame.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding)
+	bool bLogEncodeTimings;
+
 	// This culls a quad at the index. For debugging only
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Encoding)
 	int32 CullQuadIndex;
@@ -210,6 +244,13 @@ public:
 		return ServerID;
 	}
 
+	//! Decides which clients' video is captured and encoded each frame.
+	FEncodeScheduler EncodeScheduler;
+	//! The captures of all clients that are currently streaming video, for finding captures that can be shared.
+	TArray<TWeakObjectPtr<class UTeleportCaptureComponent>> StreamingCaptureComponents;
+	//! The streamable actors in the world, which sessions query to find what's near their client.
+	FStreamableSpatialIndex StreamableIndex;
+
 	static const teleport::server::ServerSettings& GetServerSettings();
 	void Tick(float DeltaTS) override;
 	void CheckForNewClients();
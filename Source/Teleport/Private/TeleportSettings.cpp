@@ -8,6 +8,9 @@ UTeleportSettings::UTeleportSettings(const FObjectInitializer& ObjectInitlaizer)
 	,VideoEncodeFrequency(3)
 	,StreamGeometry(true)
 	,SignalingPorts("8080,10601")
+	,ParallelMeshExtraction(true)
+	,IncrementalExtraction(true)
+	,LightmapBatchSize(16)
 {
 
 }
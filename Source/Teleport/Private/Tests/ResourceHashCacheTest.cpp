@@ -0,0 +1,66 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "ResourceHashCache.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTeleportResourceHashCacheTest, "Teleport.ResourceHashCache"
+	, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTeleportResourceHashCacheTest::RunTest(const FString& Parameters)
+{
+	const FString CachePath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("TeleportResourceHashCacheTest"));
+	IFileManager::Get().DeleteDirectory(*CachePath, false, true);
+	IFileManager::Get().MakeDirectory(*CachePath, true);
+
+	const FString Mesh = TEXT("/Game/Meshes/Cube");
+	const FString Material = TEXT("/Game/Materials/Brick");
+	const FString Texture = TEXT("/Game/Textures/Brick");
+	const uint64 MeshHash = 0x1234, MaterialHash = 0x5678, TextureHash = 0x9abc;
+	const uint64 MeshUid = 11, MaterialUid = 12, TextureUid = 13;
+	{
+		FResourceHashCache Cache;
+		Cache.SetCachePath(CachePath);
+		Cache.SetHash(Texture, TextureHash, TextureUid);
+		Cache.SetHash(Material, MaterialHash, MaterialUid, { Texture });
+		Cache.SetHash(Mesh, MeshHash, MeshUid);
+		Cache.Save();
+	}
+	{
+		// A later session, with the store as it was left.
+		FResourceHashCache Cache;
+		Cache.SetCachePath(CachePath);
+		TestTrue(TEXT("An unchanged mesh in an unchanged store is up to date"), Cache.IsUpToDate(Mesh, MeshHash, MeshUid));
+		TestTrue(TEXT("An unchanged material in an unchanged store is up to date"), Cache.IsUpToDate(Material, MaterialHash, MaterialUid));
+		TestFalse(TEXT("A changed mesh is out of date"), Cache.IsUpToDate(Mesh, MeshHash + 1, MeshUid));
+	}
+	{
+		// The store was cleared but the hash file kept, so the server gives each path a new uid.
+		FResourceHashCache Cache;
+		Cache.SetCachePath(CachePath);
+		TestFalse(TEXT("A mesh the store has lost is out of date"), Cache.IsUpToDate(Mesh, MeshHash, MeshUid + 100));
+		TestFalse(TEXT("A material the store has lost is out of date"), Cache.IsUpToDate(Material, MaterialHash, MaterialUid + 100));
+		// Storing it again makes it current under its new uid.
+		Cache.SetHash(Mesh, MeshHash, MeshUid + 100);
+		TestTrue(TEXT("A re-stored mesh is up to date"), Cache.IsUpToDate(Mesh, MeshHash, MeshUid + 100));
+	}
+	{
+		// Clearing the store through the geometry source clears the records too.
+		FResourceHashCache Cache;
+		Cache.SetCachePath(CachePath);
+		Cache.Clear();
+		Cache.Save();
+	}
+	{
+		FResourceHashCache Cache;
+		Cache.SetCachePath(CachePath);
+		TestFalse(TEXT("Nothing is up to date after the records are cleared"), Cache.IsUpToDate(Material, MaterialHash, MaterialUid));
+	}
+	IFileManager::Get().DeleteDirectory(*CachePath, false, true);
+	return !HasAnyErrors();
+}
+
+#endif
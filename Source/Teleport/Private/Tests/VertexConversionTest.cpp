@@ -0,0 +1,158 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "VertexConversion.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "Rendering/StaticMeshVertexBuffer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+using namespace teleport;
+using namespace unreal;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTeleportVertexConversionTest, "Teleport.VertexConversion"
+	, EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+namespace
+{
+	// An odd count, so the texcoords' single-vertex tail is covered too.
+	constexpr size_t NumVertices = 37;
+	// The vector kernels multiply by a reciprocal where the scalar ones divide.
+	constexpr float Tolerance = 1.e-5f;
+
+	const avs::AxesStandard Engineering[] = { avs::AxesStandard::EngineeringStyle };
+	const avs::AxesStandard Gl[] = { avs::AxesStandard::GlStyle };
+	const avs::AxesStandard EngineeringAndGl[] = { avs::AxesStandard::EngineeringStyle, avs::AxesStandard::GlStyle };
+	const TArrayView<const avs::AxesStandard> AxesSets[] = { Engineering, Gl, EngineeringAndGl };
+
+	bool Equal(const vec3& a, const vec3& b)
+	{
+		return FMath::IsNearlyEqual(a.x, b.x, Tolerance) && FMath::IsNearlyEqual(a.y, b.y, Tolerance) && FMath::IsNearlyEqual(a.z, b.z, Tolerance);
+	}
+
+	bool Equal(const vec4& a, const vec4& b)
+	{
+		return Equal(vec3{ a.x, a.y, a.z }, vec3{ b.x, b.y, b.z }) && FMath::IsNearlyEqual(a.w, b.w, Tolerance);
+	}
+
+	template<typename T>
+	void TestTangentBasis(FAutomationTestBase& Test, FRandomStream& Random, TArrayView<const avs::AxesStandard> AxesStandards)
+	{
+		TArray<T> Src;
+		Src.SetNum(NumVertices * 8);
+		for (T& c : Src)
+		{
+			c = T(Random.RandRange(TNumericLimits<T>::Min(), TNumericLimits<T>::Max()));
+		}
+		const float Scale = float(TNumericLimits<T>::Max());
+		TArray<vec4> Tangents[2], ScalarTangents[2];
+		TArray<vec3> Normals[2], ScalarNormals[2];
+		vec4* TangentPtrs[2];
+		vec4* ScalarTangentPtrs[2];
+		vec3* NormalPtrs[2];
+		vec3* ScalarNormalPtrs[2];
+		for (int a = 0; a < AxesStandards.Num(); a++)
+		{
+			Tangents[a].SetNumZeroed(NumVertices);
+			ScalarTangents[a].SetNumZeroed(NumVertices);
+			Normals[a].SetNumZeroed(NumVertices);
+			ScalarNormals[a].SetNumZeroed(NumVertices);
+			TangentPtrs[a] = Tangents[a].GetData();
+			ScalarTangentPtrs[a] = ScalarTangents[a].GetData();
+			NormalPtrs[a] = Normals[a].GetData();
+			ScalarNormalPtrs[a] = ScalarNormals[a].GetData();
+		}
+		ConvertTangentBasis(Src.GetData(), NumVertices, Scale, AxesStandards, TangentPtrs, NormalPtrs);
+		ConvertTangentBasis_Scalar(Src.GetData(), NumVertices, Scale, AxesStandards, ScalarTangentPtrs, ScalarNormalPtrs);
+		for (int a = 0; a < AxesStandards.Num(); a++)
+		{
+			for (size_t i = 0; i < NumVertices; i++)
+			{
+				if (!Equal(Tangents[a][i], ScalarTangents[a][i]) || !Equal(Normals[a][i], ScalarNormals[a][i]))
+				{
+					Test.AddError(FString::Printf(TEXT("ConvertTangentBasis (%d-byte) differs from the scalar path at vertex %d, axes %d."), int(sizeof(T)), int(i), int(AxesStandards[a])));
+					return;
+				}
+			}
+		}
+	}
+
+	void TestTexCoords(FAutomationTestBase& Test, FRandomStream& Random, bool bFullPrecision, uint32 NumTexCoords)
+	{
+		FStaticMeshVertexBuffer VertexBuffer;
+		VertexBuffer.SetUseFullPrecisionUVs(bFullPrecision);
+		VertexBuffer.Init(NumVertices, NumTexCoords);
+		for (uint32 i = 0; i < NumVertices; i++)
+		{
+			for (uint32 uv = 0; uv < NumTexCoords; uv++)
+			{
+				VertexBuffer.SetVertexUV(i, uv, FVector2f(Random.FRandRange(-2.f, 2.f), Random.FRandRange(-2.f, 2.f)));
+			}
+		}
+		for (uint32 uv = 0; uv < NumTexCoords; uv++)
+		{
+			for (bool bReverseY : { false, true })
+			{
+				TArray<FVector2f> Out, ScalarOut;
+				Out.SetNumZeroed(NumVertices);
+				ScalarOut.SetNumZeroed(NumVertices);
+				FVector2f Min, Max, ScalarMin, ScalarMax;
+				ConvertTexCoords(VertexBuffer, uv, bReverseY, Out.GetData(), Min, Max);
+				ConvertTexCoords_Scalar(VertexBuffer, uv, bReverseY, ScalarOut.GetData(), ScalarMin, ScalarMax);
+				if (Out != ScalarOut || Min != ScalarMin || Max != ScalarMax)
+				{
+					Test.AddError(FString::Printf(TEXT("ConvertTexCoords differs from the scalar path: full precision %d, channel %u of %u, reversed %d."), bFullPrecision, uv, NumTexCoords, bReverseY));
+				}
+			}
+		}
+		VertexBuffer.CleanUp();
+	}
+}
+
+bool FTeleportVertexConversionTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(1234);
+	for (TArrayView<const avs::AxesStandard> AxesStandards : AxesSets)
+	{
+		TArray<float> Src;
+		Src.SetNum(NumVertices * 3);
+		for (float& f : Src)
+		{
+			f = Random.FRandRange(-1000.f, 1000.f);
+		}
+		const float Scale = 0.01f;
+		TArray<vec3> Positions[2], ScalarPositions[2];
+		vec3* PositionPtrs[2];
+		vec3* ScalarPositionPtrs[2];
+		for (int a = 0; a < AxesStandards.Num(); a++)
+		{
+			Positions[a].SetNumZeroed(NumVertices);
+			ScalarPositions[a].SetNumZeroed(NumVertices);
+			PositionPtrs[a] = Positions[a].GetData();
+			ScalarPositionPtrs[a] = ScalarPositions[a].GetData();
+		}
+		ConvertPositions(Src.GetData(), NumVertices, Scale, AxesStandards, PositionPtrs);
+		ConvertPositions_Scalar(Src.GetData(), NumVertices, Scale, AxesStandards, ScalarPositionPtrs);
+		for (int a = 0; a < AxesStandards.Num(); a++)
+		{
+			for (size_t i = 0; i < NumVertices; i++)
+			{
+				if (!Equal(Positions[a][i], ScalarPositions[a][i]))
+				{
+					AddError(FString::Printf(TEXT("ConvertPositions differs from the scalar path at vertex %d, axes %d."), int(i), int(AxesStandards[a])));
+					break;
+				}
+			}
+		}
+		TestTangentBasis<int8>(*this, Random, AxesStandards);
+		TestTangentBasis<int16>(*this, Random, AxesStandards);
+	}
+	for (bool bFullPrecision : { false, true })
+	{
+		TestTexCoords(*this, Random, bFullPrecision, 1);
+		TestTexCoords(*this, Random, bFullPrecision, 2);
+	}
+	return !HasAnyErrors();
+}
+
+#endif
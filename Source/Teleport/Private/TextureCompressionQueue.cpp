@@ -0,0 +1,68 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "TextureCompressionQueue.h"
+#include "TeleportServer/PluginMain.h"
+
+FTextureCompressionQueue::~FTextureCompressionQueue()
+{
+	Cancel();
+	Wait();
+}
+
+void FTextureCompressionQueue::Start()
+{
+	if(bBusy||bCancelled)
+		return;
+	// The task isn't running, so the server is ours to ask.
+	uint64_t waiting=Server_GetNumberOfTexturesWaitingForCompression();
+	if(!waiting)
+		return;
+	Compressed=0;
+	Total=(int32)waiting;
+	bBusy=true;
+	Task=FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
+		{
+			Run();
+		},TStatId(),nullptr,ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void FTextureCompressionQueue::Run()
+{
+	while(!bCancelled&&!bStopping)
+	{
+		uint64_t waiting=Server_GetNumberOfTexturesWaitingForCompression();
+		if(!waiting)
+			break;
+		// More textures may have been stored since we started.
+		Total=Compressed+(int32)waiting;
+		Server_CompressNextTexture();
+		Compressed++;
+	}
+	bBusy=false;
+}
+
+void FTextureCompressionQueue::Cancel()
+{
+	bCancelled=true;
+}
+
+void FTextureCompressionQueue::Resume()
+{
+	bCancelled=false;
+}
+
+void FTextureCompressionQueue::Stop()
+{
+	if(!Task.IsValid())
+		return;
+	bStopping=true;
+	Wait();
+	bStopping=false;
+}
+
+void FTextureCompressionQueue::Wait()
+{
+	if(Task.IsValid()&&!Task->IsComplete())
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task);
+	Task=nullptr;
+}
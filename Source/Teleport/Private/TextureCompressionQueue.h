@@ -0,0 +1,54 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include <atomic>
+
+/*! Compresses the textures waiting in the server's queue on a background thread, so the editor stays responsive.
+
+	The server compresses one texture per Server_CompressNextTexture call, from a queue it owns, so there is at most
+	one compression task at a time. The server isn't thread-safe, and a texture can't be taken from its queue to be
+	compressed elsewhere, so the task and the game thread take turns rather than sharing a lock: the game thread calls
+	Stop() before it uses the server, which waits for at most the texture being compressed, and the task is started
+	again once the game thread has nothing else to store.
+*/
+class FTextureCompressionQueue
+{
+public:
+	~FTextureCompressionQueue();
+	//! Game thread: starts a background task if textures are waiting and none is running. Returns immediately.
+	void Start();
+	//! Stops after the current texture. Compression won't start again until Resume() is called.
+	void Cancel();
+	void Resume();
+	//! Game thread: stops after the current texture and waits for it, so the server can be used. Start() may start it again.
+	void Stop();
+	//! Blocks until the background task, if any, has finished.
+	void Wait();
+	bool IsBusy() const
+	{
+		return bBusy;
+	}
+	bool IsCancelled() const
+	{
+		return bCancelled;
+	}
+	//! Number of textures compressed by the current or last task, and the total it expects to compress.
+	void GetProgress(int32 &compressed,int32 &total) const
+	{
+		compressed=Compressed;
+		total=Total;
+	}
+
+private:
+	void Run();
+
+	FGraphEventRef Task;
+	std::atomic<bool> bBusy=false;
+	std::atomic<bool> bCancelled=false;
+	std::atomic<bool> bStopping=false;
+	std::atomic<int32> Compressed=0;
+	std::atomic<int32> Total=0;
+};
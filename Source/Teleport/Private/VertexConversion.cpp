@@ -0,0 +1,286 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#include "VertexConversion.h"
+#include "Math/VectorRegister.h"
+#include "Rendering/StaticMeshVertexBuffer.h"
+#include <algorithm>
+
+using namespace teleport;
+using namespace unreal;
+
+bool teleport::unreal::GetAxesSwizzle(avs::AxesStandard axesStandard,int &x,int &y,int &z,int &w)
+{
+	switch(axesStandard)
+	{
+		case avs::AxesStandard::GlStyle:
+			z = 0; x = 1; y = 2; w = 3;
+			return true;
+		case avs::AxesStandard::EngineeringStyle:
+			y = 0; x = 1; z = 2; w = 3;
+			return true;
+		default:
+			x = 0; y = 1; z = 2; w = 3;
+			return false;
+	}
+}
+
+namespace
+{
+	// Compile-time equivalent of GetAxesSwizzle.
+	template<avs::AxesStandard S> struct AxesOrder;
+	template<> struct AxesOrder<avs::AxesStandard::GlStyle>
+	{
+		static constexpr int x=1,y=2,z=0,w=3;
+	};
+	template<> struct AxesOrder<avs::AxesStandard::EngineeringStyle>
+	{
+		static constexpr int x=1,y=0,z=2,w=3;
+	};
+
+	template<avs::AxesStandard S> FORCEINLINE VectorRegister4Float Swizzle(const VectorRegister4Float &V)
+	{
+		return VectorSwizzle(V,AxesOrder<S>::x,AxesOrder<S>::y,AxesOrder<S>::z,AxesOrder<S>::w);
+	}
+
+	template<avs::AxesStandard... Standards>
+	void ConvertPositionsT(const float *src,size_t numVertices,float scale,vec3 *const *outputs)
+	{
+		const VectorRegister4Float Scale=VectorSetFloat1(scale);
+		for(size_t i=0;i<numVertices;i++)
+		{
+			const VectorRegister4Float P=VectorMultiply(VectorLoadFloat3(src+i*3),Scale);
+			int o=0;
+			(VectorStoreFloat3(Swizzle<Standards>(P),&outputs[o++][i].x),...);
+		}
+	}
+
+	FORCEINLINE VectorRegister4Float LoadComponents4(const int8 *src)
+	{
+		return VectorLoadSignedByte4(src);
+	}
+
+	FORCEINLINE VectorRegister4Float LoadComponents4(const int16 *src)
+	{
+		return MakeVectorRegister(float(src[0]),float(src[1]),float(src[2]),float(src[3]));
+	}
+
+	template<typename T,avs::AxesStandard... Standards>
+	void ConvertTangentBasisT(const T *src,size_t numVertices,float scale,vec4 *const *tangents,vec3 *const *normals)
+	{
+		const VectorRegister4Float InvScale=VectorSetFloat1(1.0f/scale);
+		for(size_t i=0;i<numVertices;i++)
+		{
+			const VectorRegister4Float T4=VectorMultiply(LoadComponents4(src+i*8),InvScale);
+			const VectorRegister4Float N4=VectorMultiply(LoadComponents4(src+i*8+4),InvScale);
+			int o=0;
+			(VectorStoreFloat3(Swizzle<Standards>(N4),&normals[o++][i].x),...);
+			o=0;
+			(VectorStore(Swizzle<Standards>(T4),&tangents[o++][i].x),...);
+		}
+	}
+
+	// The specialised kernels cover the standards that every server must support, in the order GeometrySource asks for them.
+	enum class KernelSet
+	{
+		Scalar,
+		Engineering,
+		Gl,
+		EngineeringAndGl
+	};
+
+	KernelSet GetKernelSet(TArrayView<const avs::AxesStandard> axesStandards)
+	{
+		if(axesStandards.Num()==1)
+		{
+			if(axesStandards[0]==avs::AxesStandard::EngineeringStyle)
+				return KernelSet::Engineering;
+			if(axesStandards[0]==avs::AxesStandard::GlStyle)
+				return KernelSet::Gl;
+		}
+		else if(axesStandards.Num()==2)
+		{
+			if(axesStandards[0]==avs::AxesStandard::EngineeringStyle&&axesStandards[1]==avs::AxesStandard::GlStyle)
+				return KernelSet::EngineeringAndGl;
+		}
+		return KernelSet::Scalar;
+	}
+
+	template<typename T>
+	void ConvertTangentBasisDispatch(const T *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals)
+	{
+		switch(GetKernelSet(axesStandards))
+		{
+			case KernelSet::Engineering:
+				ConvertTangentBasisT<T,avs::AxesStandard::EngineeringStyle>(src,numVertices,scale,tangents,normals);
+				break;
+			case KernelSet::Gl:
+				ConvertTangentBasisT<T,avs::AxesStandard::GlStyle>(src,numVertices,scale,tangents,normals);
+				break;
+			case KernelSet::EngineeringAndGl:
+				ConvertTangentBasisT<T,avs::AxesStandard::EngineeringStyle,avs::AxesStandard::GlStyle>(src,numVertices,scale,tangents,normals);
+				break;
+			default:
+				ConvertTangentBasis_Scalar(src,numVertices,scale,axesStandards,tangents,normals);
+				break;
+		}
+	}
+
+	FORCEINLINE FVector2f GetTexCoord(const void *texCoordData,bool fullPrecision,size_t index)
+	{
+		if(fullPrecision)
+			return static_cast<const FVector2f*>(texCoordData)[index];
+		const FVector2DHalf &h=static_cast<const FVector2DHalf*>(texCoordData)[index];
+		return FVector2f(float(h.X),float(h.Y));
+	}
+}
+
+void teleport::unreal::ConvertPositions(const float *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec3 *const *outputs)
+{
+	switch(GetKernelSet(axesStandards))
+	{
+		case KernelSet::Engineering:
+			ConvertPositionsT<avs::AxesStandard::EngineeringStyle>(src,numVertices,scale,outputs);
+			break;
+		case KernelSet::Gl:
+			ConvertPositionsT<avs::AxesStandard::GlStyle>(src,numVertices,scale,outputs);
+			break;
+		case KernelSet::EngineeringAndGl:
+			ConvertPositionsT<avs::AxesStandard::EngineeringStyle,avs::AxesStandard::GlStyle>(src,numVertices,scale,outputs);
+			break;
+		default:
+			ConvertPositions_Scalar(src,numVertices,scale,axesStandards,outputs);
+			break;
+	}
+}
+
+void teleport::unreal::ConvertTangentBasis(const int8 *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals)
+{
+	ConvertTangentBasisDispatch(src,numVertices,scale,axesStandards,tangents,normals);
+}
+
+void teleport::unreal::ConvertTangentBasis(const int16 *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals)
+{
+	ConvertTangentBasisDispatch(src,numVertices,scale,axesStandards,tangents,normals);
+}
+
+void teleport::unreal::ConvertTexCoords(const FStaticMeshVertexBuffer &vb,uint32 uvIndex,bool reverseY,FVector2f *out,FVector2f &uvMin,FVector2f &uvMax)
+{
+	const size_t numVertices=vb.GetNumVertices();
+	const size_t numTexCoords=vb.GetNumTexCoords();
+	const bool fullPrecision=vb.GetUseFullPrecisionUVs();
+	const void *texCoordData=vb.GetTexCoordData();
+	// Two texcoords per register: v becomes 1-v with a single multiply-add.
+	const VectorRegister4Float Mul=reverseY?MakeVectorRegister(1.f,-1.f,1.f,-1.f):VectorOne();
+	const VectorRegister4Float Add=reverseY?MakeVectorRegister(0.f,1.f,0.f,1.f):VectorZero();
+	VectorRegister4Float Min=VectorSetFloat1(100000.f);
+	VectorRegister4Float Max=VectorSetFloat1(-100000.f);
+	size_t k=0;
+	for(;k+1<numVertices;k+=2)
+	{
+		VectorRegister4Float UV;
+		if(fullPrecision&&numTexCoords==1)
+		{
+			UV=VectorLoad(&static_cast<const FVector2f*>(texCoordData)[k].X);
+		}
+		else
+		{
+			FVector2f a=GetTexCoord(texCoordData,fullPrecision,k*numTexCoords+uvIndex);
+			FVector2f b=GetTexCoord(texCoordData,fullPrecision,(k+1)*numTexCoords+uvIndex);
+			UV=MakeVectorRegister(a.X,a.Y,b.X,b.Y);
+		}
+		UV=VectorMultiplyAdd(UV,Mul,Add);
+		Min=VectorMin(Min,UV);
+		Max=VectorMax(Max,UV);
+		VectorStore(UV,&out[k].X);
+	}
+	// Fold the two halves of each register together.
+	Min=VectorMin(Min,VectorSwizzle(Min,2,3,0,1));
+	Max=VectorMax(Max,VectorSwizzle(Max,2,3,0,1));
+	alignas(16) float mn[4],mx[4];
+	VectorStoreAligned(Min,mn);
+	VectorStoreAligned(Max,mx);
+	uvMin={mn[0],mn[1]};
+	uvMax={mx[0],mx[1]};
+	for(;k<numVertices;k++)
+	{
+		FVector2f v2=GetTexCoord(texCoordData,fullPrecision,k*numTexCoords+uvIndex);
+		if(reverseY)
+			v2.Y=1.0f-v2.Y;
+		out[k]=v2;
+		uvMin.X=std::min(uvMin.X,v2.X);
+		uvMin.Y=std::min(uvMin.Y,v2.Y);
+		uvMax.X=std::max(uvMax.X,v2.X);
+		uvMax.Y=std::max(uvMax.Y,v2.Y);
+	}
+}
+
+void teleport::unreal::ConvertPositions_Scalar(const float *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec3 *const *outputs)
+{
+	TArray<int,TInlineAllocator<16>> s;
+	s.SetNum(axesStandards.Num()*4);
+	for(int a=0;a<axesStandards.Num();a++)
+		GetAxesSwizzle(axesStandards[a],s[a*4],s[a*4+1],s[a*4+2],s[a*4+3]);
+	for(size_t j=0;j<numVertices;j++)
+	{
+		const float *orig=src+j*3;
+		for(int a=0;a<axesStandards.Num();a++)
+		{
+			vec3 &p=outputs[a][j];
+			p.x=orig[s[a*4]]*scale;
+			p.y=orig[s[a*4+1]]*scale;
+			p.z=orig[s[a*4+2]]*scale;
+		}
+	}
+}
+
+template<typename T>
+void teleport::unreal::ConvertTangentBasis_Scalar(const T *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals)
+{
+	TArray<int,TInlineAllocator<16>> s;
+	s.SetNum(axesStandards.Num()*4);
+	for(int a=0;a<axesStandards.Num();a++)
+		GetAxesSwizzle(axesStandards[a],s[a*4],s[a*4+1],s[a*4+2],s[a*4+3]);
+	for(size_t i=0;i<numVertices;i++)
+	{
+		const T *original=src+i*8;
+		for(int a=0;a<axesStandards.Num();a++)
+		{
+			const int x=s[a*4],y=s[a*4+1],z=s[a*4+2],w=s[a*4+3];
+			//Tangents
+			vec4 &t=tangents[a][i];
+			t.x=float(original[x])/scale;
+			t.y=float(original[y])/scale;
+			t.z=float(original[z])/scale;
+			t.w=float(original[w])/scale;
+
+			//Normals
+			vec3 &n=normals[a][i];
+			n.x=float(original[4+x])/scale;
+			n.y=float(original[4+y])/scale;
+			n.z=float(original[4+z])/scale;
+		}
+	}
+}
+
+template void teleport::unreal::ConvertTangentBasis_Scalar<int8>(const int8 *,size_t,float,TArrayView<const avs::AxesStandard>,vec4 *const *,vec3 *const *);
+template void teleport::unreal::ConvertTangentBasis_Scalar<int16>(const int16 *,size_t,float,TArrayView<const avs::AxesStandard>,vec4 *const *,vec3 *const *);
+
+void teleport::unreal::ConvertTexCoords_Scalar(const FStaticMeshVertexBuffer &vb,uint32 uvIndex,bool reverseY,FVector2f *out,FVector2f &uvMin,FVector2f &uvMax)
+{
+	uvMin={100000.f,100000.f};
+	uvMax={-100000.f,-100000.f};
+	for(uint32_t k=0;k<vb.GetNumVertices();k++)
+	{
+		FVector2f v2=vb.GetVertexUV(k,uvIndex);
+		// Reverse y texcoord for consistency with Vulkan, GLTF, OpenGL.
+		if(reverseY)
+		{
+			v2.Y=1.0f-v2.Y;
+		}
+		out[k]=v2;
+		uvMin.X=std::min(uvMin.X,v2.X);
+		uvMin.Y=std::min(uvMin.Y,v2.Y);
+		uvMax.X=std::max(uvMax.X,v2.X);
+		uvMax.Y=std::max(uvMax.Y,v2.Y);
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright 2018-2024 Teleport XR Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Platform/CrossPlatform/Shaders/CppSl.sl"
+#include "libavstream/common_maths.h"
+
+class FStaticMeshVertexBuffer;
+
+/*! Bulk conversion of Unreal's vertex streams into the layouts the geometry store expects.
+
+	Each source vertex is read once and written to every requested axes standard.
+	EngineeringStyle and GlStyle have kernels specialised at compile time, written against Unreal's
+	portable VectorRegister4Float API, so they use whatever SIMD the platform provides.
+	Any other standard goes through the scalar path, which swizzles through runtime indices.
+	Tests/VertexConversionTest.cpp checks each kernel against its _Scalar reference.
+*/
+namespace teleport
+{
+	namespace unreal
+	{
+		//! Component order used to write Unreal's x,y,z,w into the given axes standard. Returns false if the standard is unsupported.
+		bool GetAxesSwizzle(avs::AxesStandard axesStandard,int &x,int &y,int &z,int &w);
+
+		//! Positions: outputs[a][i] is src vertex i, swizzled into axesStandards[a] and multiplied by scale.
+		void ConvertPositions(const float *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec3 *const *outputs);
+		//! Unreal's packed tangent basis: 8 components per vertex, tangent xyzw then normal xyzw, divided by scale.
+		void ConvertTangentBasis(const int8 *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals);
+		void ConvertTangentBasis(const int16 *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals);
+		//! Copies texcoord channel uvIndex of every vertex into out, optionally as 1-v, and finds its range.
+		void ConvertTexCoords(const FStaticMeshVertexBuffer &vb,uint32 uvIndex,bool reverseY,FVector2f *out,FVector2f &uvMin,FVector2f &uvMax);
+
+		//! Reference implementations, one scalar at a time.
+		void ConvertPositions_Scalar(const float *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec3 *const *outputs);
+		template<typename T>
+		void ConvertTangentBasis_Scalar(const T *src,size_t numVertices,float scale,TArrayView<const avs::AxesStandard> axesStandards,vec4 *const *tangents,vec3 *const *normals);
+		void ConvertTexCoords_Scalar(const FStaticMeshVertexBuffer &vb,uint32 uvIndex,bool reverseY,FVector2f *out,FVector2f &uvMin,FVector2f &uvMax);
+	}
+}
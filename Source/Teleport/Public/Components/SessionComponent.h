@@ -15,8 +15,8 @@
 
 #include "SessionComponent.generated.h"
 
-class USphereComponent;
 class UStreamableRootComponent;
+class FGeometryStreamingQueue;
 class UTeleportPawnComponent;
 
 namespace avs
@@ -86,22 +86,25 @@ int playerId=0;
 	static void TranslateButtons(uint32_t ButtonMask, TArray<FKey>& OutKeys);
 	void StopStreaming();
 
+	//! Streams the actors that have come within DetectionSphereRadius of the client, and unstreams those that have gone
+	//! beyond DetectionSphereRadius+DetectionSphereBufferDistance.
 	void StreamNearbyNodes();
-
-	UFUNCTION()
-	void OnInnerSphereBeginOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor, UPrimitiveComponent *OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult &SweepResult);
-
-	UFUNCTION()
-	void OnOuterSphereEndOverlap(UPrimitiveComponent *OverlappedComponent, AActor *OtherActor, UPrimitiveComponent *OtherComp, int32 OtherBodyIndex);
+	//! Streams the queued actors that the client's share of the bandwidth allows, most important first.
+	void StreamQueuedNodes(float DeltaTime);
 
 	avs::uid StreamToClient(UStreamableRootComponent *);
 	void UnstreamFromClient(UStreamableRootComponent *);
-	void AddDetectionSpheres();
 
 	TWeakObjectPtr<AActor> ClientActor;
 
-	TWeakObjectPtr<USphereComponent> DetectionSphereInner; //Detects when a steamable actor has moved close enough to the client to be sent to them.
-	TWeakObjectPtr<USphereComponent> DetectionSphereOuter; //Detects when a streamable actor has moved too far from the client.
+	// The actors streamed because they're near the client.
+	TSet<TWeakObjectPtr<UStreamableRootComponent>> NearbyRoots;
+	// Where the client was, and the version of the spatial index, when NearbyRoots was last updated.
+	FVector NearbyQueryLocation = FVector::ZeroVector;
+	uint32 NearbyQueryVersion = 0;
+	bool bNearbyQueried = false;
+	// Nearby actors that haven't been streamed yet.
+	TUniquePtr<FGeometryStreamingQueue> StreamingQueue;
 
 	struct FInputQueue
 	{
@@ -11,6 +11,7 @@ namespace avs
 {
 	typedef uint64_t uid;
 }
+class ATeleportMonitor;
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class TELEPORT_API UStreamableRootComponent : public UActorComponent
@@ -34,17 +35,21 @@ public:
 
 	void OnRegister() override;
 
-	// delegate for motion:
-	void OnMoved(AActor* Actor);
+	//! Adds this actor to the monitor's spatial index, if it isn't in one already.
+	void AddToMonitor(ATeleportMonitor *m);
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type Reason) override;
+	// The monitor whose spatial index this is in.
+	TWeakObjectPtr<ATeleportMonitor> Monitor;
+	// Movable actors report their motion through their movable components, rather than by ticking.
+	// A child can move relative to the root, so each is bound, not just the root.
+	void OnMovableTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	TMap<TWeakObjectPtr<USceneComponent>,FDelegateHandle> MovableComponents;
 	TMap<USceneComponent*,TWeakObjectPtr<UStreamableNode>> streamableNodes;
 	bool nodesInitialized=false;
+	UStreamableNode *FindOrAddStreamableNode(USceneComponent *sc);
 	bool AddSceneComponentStreamableNode(USceneComponent *sc);
-
-public:	
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-
 };
@@ -41,6 +41,13 @@ public:
 	void requestKeyframe();
 
 	teleport::server::CameraInfo& getClientCameraInfo();
+	//! The number of this client's video frames that were encoded later than they were due.
+	uint64 GetEncodeDeadlineMisses() const;
+	//! True if another client's capture is being rendered and encoded for this client too.
+	bool IsSharingCapture() const
+	{
+		return CaptureLeader.IsValid();
+	}
 
 	bool ShouldRenderFace(int32 FaceId) const ;//override;
 
@@ -55,27 +62,57 @@ public:
 	const FUnrealCasterEncoderSettings& GetEncoderSettings();
 private: 
 	avs::uid clientId=0;
-	struct FQuad
+	//! The corners of the cube's blocks, four per block in the order bottom-left, top-left, bottom-right, top-right.
+	//! Stored as separate x, y and z arrays, so that each coordinate of a block's four corners loads as one vector.
+	struct FCubeBlockCorners
 	{
-		FVector BottomLeft;
-		FVector TopLeft;
-		FVector BottomRight;
-		FVector TopRight;
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+		int32 BlocksPerFaceAcross = 0;
+		int32 NumBlocks = 0;
 	};
 
 	void OnViewportDrawn();
 	FDelegateHandle ViewportDrawnDelegateHandle;
-	void CullHiddenCubeSegments();
-	static void CreateCubeQuads(TArray<FQuad>& Quads, uint32 BlocksPerFaceAcross, float CubeWidth);
-	static bool VectorIntersectsFrustum(const FVector& Vector, const FMatrix& ViewProjection);
+	//! Works out which cube blocks and faces are visible to the given camera. If bAccumulate, blocks already visible stay visible.
+	void CullHiddenCubeSegments(const teleport::server::CameraInfo& CamInfo, bool bAccumulate);
+	//! Renders only the faces, and the parts of faces, that contain visible blocks, then copies them into the cubemap.
+	void CaptureVisibleFaces(FSceneInterface* Scene);
+	//! The texels of the face covered by its visible blocks, grown to a multiple of a quarter face. Empty if no block is visible.
+	FIntRect GetVisibleFaceRect(int32 FaceId) const;
+	class UTextureRenderTarget2D* GetFaceRenderTarget(FIntPoint Size);
+	//! Prepares the frame to encode from the given cubemap: decomposes it, and adds the reflections.
+	void PrepareVideoFrame(FSceneInterface* Scene, UTextureRenderTargetCube* Cubemap, FTransform& Transform, const TArray<bool>& BlockFlags);
+	void EncodeVideoFrame(FSceneInterface* Scene, UTextureRenderTargetCube* Cubemap, FTransform& Transform);
+
+	//! Adopts nearby clients that can share this capture, and releases those that no longer can.
+	void UpdateCaptureGroup(class ATeleportMonitor* Monitor);
+	bool CanFollowCapture(const UTeleportCaptureComponent* Leader, float MaxDistance) const;
+	void SetCaptureLeader(UTeleportCaptureComponent* Leader, class ATeleportMonitor* Monitor);
+	//! Encodes this client's frame from the leader's capture, which has just been rendered.
+	void EncodeSharedFrame(FSceneInterface* Scene, UTeleportCaptureComponent* Leader);
+	static void CreateCubeQuads(FCubeBlockCorners& Corners, uint32 BlocksPerFaceAcross, float CubeWidth);
 
 	std::unique_ptr<IEncodePipeline> EncodePipeline;
 	teleport::server::CameraInfo ClientCamInfo;
 
-	TArray<FQuad> CubeQuads;
+	FCubeBlockCorners CubeCorners;
 	TArray<bool> QuadsToRender;
 	TArray<bool> FacesToRender;
 
+	// Renders one face of the cubemap at a time when culling, so that hidden faces cost nothing.
+	UPROPERTY(Transient)
+	class USceneCaptureComponent2D* FaceCaptureComponent;
+	// The face capture's render targets, by size.
+	UPROPERTY(Transient)
+	TMap<FIntPoint, class UTextureRenderTarget2D*> FaceRenderTargets;
+
+	// Set while this client uses another client's capture instead of rendering its own.
+	TWeakObjectPtr<UTeleportCaptureComponent> CaptureLeader;
+	// The clients using this client's capture.
+	TArray<TWeakObjectPtr<UTeleportCaptureComponent>> CaptureFollowers;
+
 	class UTeleportReflectionCaptureComponent *TeleportReflectionCaptureComponent;
 	bool bIsStreaming;
 	bool bSendKeyframe;
@@ -13,8 +13,6 @@ class FScene;
 struct FCubeTexture
 {
 	FTextureCubeRHIRef TextureCubeRHIRef;
-	FUnorderedAccessViewRHIRef UnorderedAccessViewRHIRefs[8];
-	FShaderResourceViewRHIRef TextureCubeMipRHIRefs[8];
 };
 
 UCLASS(hidecategories = (Collision, Object, Physics, SceneComponent), meta = (BlueprintSpawnableComponent))
@@ -35,13 +33,31 @@ class UTeleportReflectionCaptureComponent : public UReflectionCaptureComponent
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
 	class UTextureRenderTargetCube* OverrideTexture;
 
+	/** Update one of the specular, rough specular, diffuse and lighting cubes per encoded frame, instead of all four. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ReflectionCapture)
+	bool bAmortiseUpdates = true;
+
+	/** How many times the convolved cubes are updated after a change, accumulating samples, before they are left as they are. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ReflectionCapture, meta = (ClampMin = "1", UIMax = "64"))
+	int32 AccumulationPasses = 16;
+
+	/** How far, in cm, the capture must move before the reflections are updated again. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ReflectionCapture, meta = (ClampMin = "0"))
+	float UpdateDistance = 10.0f;
+
+	/** Update the reflections after this many encoded frames, even if the capture hasn't moved, to pick up changes in the scene. Zero for never. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ReflectionCapture, meta = (ClampMin = "0"))
+	int32 RefreshFrames = 300;
+
 public:
 	virtual void UpdatePreviewShape() override;
 	virtual float GetInfluenceBoundingRadius() const override;
 	void Initialise();
-	void UpdateContents(FScene *Scene, class UTextureRenderTargetCube *src, ERHIFeatureLevel::Type FeatureLevel) ;
-
-	void PrepareFrame(FScene *Scene, struct FSurfaceTexture *UAV, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset);
+	//! Updates the reflections from the cubemap captured at SourceLocation, if anything has changed since they converged.
+	//! The GPU time is added to Timings, if not null.
+	void UpdateContents(FScene *Scene, class UTextureRenderTargetCube *src, ERHIFeatureLevel::Type FeatureLevel, const FVector &SourceLocation, class FEncodeTimings *Timings) ;
+	//! Writes the reflections into the encoder's surface. The GPU time is added to Timings, if not null.
+	void PrepareFrame(FScene *Scene, struct FSurfaceTexture *UAV, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset, class FEncodeTimings *Timings);
 
 	// To test:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
@@ -51,23 +67,36 @@ public:
 private:
 	void Initialize_RenderThread(FRHICommandListImmediate& RHICmdList);
 	void Release_RenderThread(FRHICommandListImmediate& RHICmdList);
-	void UpdateReflections_RenderThread(FRHICommandListImmediate& RHICmdList, FScene *Scene, UTextureRenderTargetCube *InSourceTexture, ERHIFeatureLevel::Type FeatureLevel);
-	void WriteReflections_RenderThread(FRHICommandListImmediate& RHICmdList, FScene *Scene, struct FSurfaceTexture *, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset);
+	void UpdateReflections_RenderThread(FRHICommandListImmediate& RHICmdList, FScene *Scene, UTextureRenderTargetCube *InSourceTexture, ERHIFeatureLevel::Type FeatureLevel, FVector SourceLocation, bool bSourceChanged, bool bAmortise, uint32 NumAccumulationPasses, class FEncodeTimings *Timings);
+	void WriteReflections_RenderThread(FRHICommandListImmediate& RHICmdList, FScene *Scene, struct FSurfaceTexture *, ERHIFeatureLevel::Type FeatureLevel, FIntPoint StartOffset, class FEncodeTimings *Timings);
 
 	void Init(FRHICommandListImmediate& RHICmdList,FCubeTexture &t, int32 size, int32 mips);
 	void Release(FCubeTexture &t);
-	struct FShaderDirectionalLight
-	{
-		FLinearColor Color;
-		FVector Direction;
-		uint32_t pad;
-	};
 
 	FCubeTexture SpecularCubeTexture;
 	FCubeTexture RoughSpecularCubeTexture;
 	FCubeTexture DiffuseCubeTexture;
 	FCubeTexture LightingCubeTexture;
-	uint32 randomSeed = 0;
+	// Each update refreshes some of these cubes.
+	enum EReflectionStage
+	{
+		Specular,
+		RoughSpecular,
+		Diffuse,
+		Lighting,
+		NumReflectionStages
+	};
+	// Render thread: the passes each stage has had since its inputs last changed, and the stage to update next.
+	// The stage's pass count is the random seed of its convolution, so a converged cube is always the same,
+	// and sets its weight in the running mean of the passes.
+	uint32 StagePasses[NumReflectionStages] = {};
+	int32 NextStage = 0;
+	uint32 LightsVersion = 0;
+	bool bNeedsFullUpdate = true;
+	// Game thread: where the reflections were last updated from.
+	FVector LastUpdateLocation = FVector::ZeroVector;
+	int32 FramesSinceUpdate = 0;
+	bool bHasUpdated = false;
 	FIntPoint specularOffset;
 	FIntPoint diffuseOffset ;
 	FIntPoint roughOffset;
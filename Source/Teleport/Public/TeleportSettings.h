@@ -27,6 +27,18 @@ class TELEPORT_API UTeleportSettings : public UDeveloperSettings
 	UPROPERTY(config, EditAnywhere, Category = Teleport)
 	FString SignalingPorts;
 
+	/** Convert mesh buffers on worker threads when extracting many nodes at once. */
+	UPROPERTY(config, EditAnywhere, Category = Teleport)
+	uint32 ParallelMeshExtraction : 1;
+
+	/** Only re-extract meshes, materials and textures whose content has changed since they were stored, even when extraction is forced. */
+	UPROPERTY(config, EditAnywhere, Category = Teleport)
+	uint32 IncrementalExtraction : 1;
+
+	/** Number of lightmaps decoded together in one render graph when extracting. */
+	UPROPERTY(config, EditAnywhere, Category = Teleport, meta = (ClampMin = 1))
+	int32 LightmapBatchSize;
+
 	void Apply();
 
 	// Begin UDeveloperSettings Interface
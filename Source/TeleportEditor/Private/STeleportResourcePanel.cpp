@@ -5,9 +5,13 @@
 #include "SlateOptMacros.h"
 #include "Widgets/SBoxPanel.h"
 #include "Widgets/Input/SButton.h"
+#include "Widgets/Notifications/SProgressBar.h"
+#include "Widgets/Text/STextBlock.h"
 #include "TeleportEditorModule.h"
 #include "LevelEditor.h"
 #include "Selection.h"
+#include "Teleport.h"
+#include "GeometrySource.h"
 BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
 void STeleportResourcePanel::Construct(const FArguments& InArgs)
 {
@@ -36,6 +40,33 @@ void STeleportResourcePanel::Construct(const FArguments& InArgs)
 			.OnClicked( this, &STeleportResourcePanel::MakeSelectedStreamable )
 			.IsEnabled(this, &STeleportResourcePanel::IsAnythingSelected)
 		]
+		// Texture compression runs in the background; show its progress while it does.
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding( 16.0f, 0.0f )
+		[
+			SNew( STextBlock )
+			.Text( this, &STeleportResourcePanel::GetTextureCompressionText )
+			.Visibility( this, &STeleportResourcePanel::GetTextureCompressionVisibility )
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding( 16.0f, 4.0f )
+		[
+			SNew( SProgressBar )
+			.Percent( this, &STeleportResourcePanel::GetTextureCompressionPercent )
+			.Visibility( this, &STeleportResourcePanel::GetTextureCompressionVisibility )
+		]
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding( 16.0f, 4.0f )
+		.HAlign(HAlign_Left)
+		[
+			SNew( SButton )
+			.Text( NSLOCTEXT("", "CancelTextureCompression", "Cancel Compression") )
+			.OnClicked( this, &STeleportResourcePanel::CancelTextureCompression )
+			.Visibility( this, &STeleportResourcePanel::GetTextureCompressionVisibility )
+		]
 	];
 	
 }
@@ -61,4 +92,33 @@ FReply STeleportResourcePanel::MakeSelectedStreamable()
 	return FReply::Handled();
 }
 
+FReply STeleportResourcePanel::CancelTextureCompression()
+{
+	ITeleport::Get().GetGeometrySource()->CancelTextureCompression();
+	return FReply::Handled();
+}
+
+EVisibility STeleportResourcePanel::GetTextureCompressionVisibility() const
+{
+	int32 compressed=0,total=0;
+	bool busy=ITeleport::Get().GetGeometrySource()->GetTextureCompressionProgress(compressed,total);
+	return busy?EVisibility::Visible:EVisibility::Collapsed;
+}
+
+TOptional<float> STeleportResourcePanel::GetTextureCompressionPercent() const
+{
+	int32 compressed=0,total=0;
+	ITeleport::Get().GetGeometrySource()->GetTextureCompressionProgress(compressed,total);
+	if(!total)
+		return TOptional<float>();
+	return float(compressed)/float(total);
+}
+
+FText STeleportResourcePanel::GetTextureCompressionText() const
+{
+	int32 compressed=0,total=0;
+	ITeleport::Get().GetGeometrySource()->GetTextureCompressionProgress(compressed,total);
+	return FText::Format(NSLOCTEXT("", "CompressingTextures", "Compressing textures: {0} of {1}"),compressed,total);
+}
+
 END_SLATE_FUNCTION_BUILD_OPTIMIZATION
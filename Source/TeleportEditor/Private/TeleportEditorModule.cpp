@@ -114,6 +114,7 @@ void FTeleportEditorModule::ExtractResources()
 	USelection *SelectedActors = GEditor->GetSelectedActors();
 	TArray<AActor *> Actors;
 	TArray<ULevel *> UniqueLevels;
+	TArray<UStreamableNode *> Nodes;
 	for (FSelectionIterator Iter(*SelectedActors); Iter; ++Iter)
 	{
 		AActor *Actor = CastChecked<AActor>(*Iter);
@@ -125,8 +126,7 @@ void FTeleportEditorModule::ExtractResources()
 		const auto &nodes=root->GetStreamableNodes();
 		for(const auto &n:nodes)
 		{
-			geometrySource->ExtractResourcesForNode(n.Value.Get(),true);
-			geometrySource->AddNode(n.Value.Get(),true);
+			Nodes.Add(n.Value.Get());
 		}
 	/*	TArray<UMeshComponent*> meshc;
 		Actor->GetComponents(meshc);
@@ -137,6 +137,12 @@ void FTeleportEditorModule::ExtractResources()
 			TArray<UMaterialInterface*> materials=meshComponent->GetMaterials();
 		}*/
 	}
+	// Gather all the nodes first, so their meshes can be extracted in parallel.
+	geometrySource->ExtractResourcesForNodes(Nodes,true);
+	for(UStreamableNode *n:Nodes)
+	{
+		geometrySource->AddNode(n,true);
+	}
 }
 
 void FTeleportEditorModule::MakeSelectedStreamable()
@@ -162,11 +168,6 @@ void FTeleportEditorModule::MakeSelectedStreamable()
 			Actor->AddComponentByClass(UStreamableRootComponent::StaticClass(),false,FTransform(),false);
 		#endif
 		}
-		UStaticMeshComponent *StaticMeshComponent=Actor->GetComponentByClass<UStaticMeshComponent>();
-		if(StaticMeshComponent)
-		{
-			StaticMeshComponent->SetGenerateOverlapEvents(true);
-		}
 		Actor->MarkPackageDirty();
 	}
 }
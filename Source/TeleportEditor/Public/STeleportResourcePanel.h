@@ -19,6 +19,10 @@ public:
 	void Construct(const FArguments& InArgs);
 	FReply ExtractSelected();
 	FReply MakeSelectedStreamable();
+	FReply CancelTextureCompression();
 
 	bool IsAnythingSelected() const;
+	EVisibility GetTextureCompressionVisibility() const;
+	TOptional<float> GetTextureCompressionPercent() const;
+	FText GetTextureCompressionText() const;
 };